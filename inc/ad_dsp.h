@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2021 Alexandros Theodotou <alex at zrythm dot org>
+ *
+ * This file is part of libaudec
+ *
+ * libaudec is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libaudec is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with libaudec.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Sample buffer operations used by the decoding
+ * pipeline.
+ */
+
+#ifndef __AD_DSP_H__
+#define __AD_DSP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Splits interleaved frames into one buffer per
+ * channel.
+ *
+ * @param src Interleaved frames.
+ * @param dst Per-channel buffers.
+ * @param dst_offset Frame offset to write to in
+ *   each of \p dst.
+ * @param channels Number of channels.
+ * @param frames Number of frames.
+ */
+void
+ad_deinterleave (
+  const float *   src,
+  float * const * dst,
+  size_t          dst_offset,
+  unsigned int    channels,
+  size_t          frames);
+
+/**
+ * Picks channels out of interleaved frames.
+ *
+ * @param src Interleaved frames.
+ * @param in_channels Number of channels in \p src.
+ * @param dst Interleaved output frames.
+ * @param map Channel of \p src to copy for each
+ *   output channel.
+ * @param out_channels Number of channels in \p dst.
+ * @param frames Number of frames.
+ */
+void
+ad_select_channels (
+  const float *        src,
+  unsigned int         in_channels,
+  float *              dst,
+  const unsigned int * map,
+  unsigned int         out_channels,
+  size_t               frames);
+
+/**
+ * Copies a range of consecutive channels out of
+ * interleaved frames.
+ *
+ * @param src Interleaved frames.
+ * @param in_channels Number of channels in \p src.
+ * @param dst Interleaved frames of \p num_channels
+ *   channels.
+ * @param first_channel First channel of \p src to
+ *   copy.
+ * @param num_channels Number of channels to copy.
+ * @param frames Number of frames.
+ */
+void
+ad_select_channels_range (
+  const float *  src,
+  unsigned int   in_channels,
+  float *        dst,
+  unsigned int   first_channel,
+  unsigned int   num_channels,
+  size_t         frames);
+
+/**
+ * Writes interleaved frames into a range of
+ * consecutive channels of wider interleaved frames.
+ *
+ * This is the inverse of
+ * ad_select_channels_range().
+ */
+void
+ad_interleave_channels (
+  const float *  src,
+  unsigned int   num_channels,
+  float *        dst,
+  unsigned int   first_channel,
+  unsigned int   out_channels,
+  size_t         frames);
+
+/**
+ * Mixes interleaved frames through a matrix.
+ *
+ * @param src Interleaved frames.
+ * @param in_channels Number of channels in \p src.
+ * @param dst Interleaved output frames.
+ * @param matrix Gain of each input channel for each
+ *   output channel, with \p out_channels rows of
+ *   \p in_channels columns.
+ * @param out_channels Number of channels in \p dst.
+ * @param frames Number of frames.
+ */
+void
+ad_mix_channels (
+  const float *  src,
+  unsigned int   in_channels,
+  float *        dst,
+  const float *  matrix,
+  unsigned int   out_channels,
+  size_t         frames);
+
+/**
+ * Averages all channels of interleaved frames into
+ * a mono buffer.
+ *
+ * @param src Interleaved frames.
+ * @param dst Mono buffer of \p frames samples.
+ * @param channels Number of channels.
+ * @param frames Number of frames.
+ */
+void
+ad_downmix_mono (
+  const float * src,
+  float *       dst,
+  unsigned int  channels,
+  size_t        frames);
+
+/**
+ * Same as ad_downmix_mono() but writes doubles.
+ */
+void
+ad_downmix_mono_dbl (
+  const float * src,
+  double *      dst,
+  unsigned int  channels,
+  size_t        frames);
+
+/**
+ * Multiplies samples by a gain in place.
+ *
+ * @param buf Samples.
+ * @param len Number of samples.
+ * @param gain Gain to apply.
+ */
+void
+ad_apply_gain (
+  float *        buf,
+  size_t         len,
+  float          gain);
+
+/**
+ * Returns the dot product of two buffers.
+ *
+ * @param a First buffer.
+ * @param b Second buffer.
+ * @param len Number of samples in each buffer.
+ */
+float
+ad_dot_product (
+  const float *  a,
+  const float *  b,
+  size_t         len);
+
+/**
+ * Encodings of uncompressed samples.
+ */
+typedef enum ad_pcm_format
+{
+  AD_PCM_U8,
+  AD_PCM_S8,
+  AD_PCM_S16_LE,
+  AD_PCM_S16_BE,
+  AD_PCM_S24_LE,
+  AD_PCM_S24_BE,
+  AD_PCM_S32_LE,
+  AD_PCM_S32_BE,
+  AD_PCM_F32_LE,
+  AD_PCM_F32_BE,
+  AD_PCM_F64_LE,
+  AD_PCM_F64_BE,
+} ad_pcm_format;
+
+/**
+ * Returns the size in bytes of a sample.
+ */
+size_t
+ad_pcm_get_sample_size (
+  ad_pcm_format format);
+
+/**
+ * Converts samples to floats.
+ *
+ * Integer samples are scaled the same way as
+ * libsndfile does, by the inverse of their
+ * full-scale value.
+ *
+ * @param src Samples in \p format.
+ * @param format Encoding of \p src.
+ * @param dst Float samples.
+ * @param len Number of samples.
+ */
+void
+ad_pcm_to_float (
+  const uint8_t * src,
+  ad_pcm_format   format,
+  float *         dst,
+  size_t          len);
+
+/**
+ * Same as ad_pcm_to_float() but writes 16-bit
+ * integers.
+ *
+ * Integer samples keep their most significant
+ * bits, and float samples are clipped.
+ */
+void
+ad_pcm_to_short (
+  const uint8_t * src,
+  ad_pcm_format   format,
+  int16_t *       dst,
+  size_t          len);
+
+/**
+ * Same as ad_pcm_to_short() but writes 32-bit
+ * integers.
+ */
+void
+ad_pcm_to_int (
+  const uint8_t * src,
+  ad_pcm_format   format,
+  int32_t *       dst,
+  size_t          len);
+
+/**
+ * Same as ad_pcm_to_float() but writes doubles.
+ */
+void
+ad_pcm_to_double (
+  const uint8_t * src,
+  ad_pcm_format   format,
+  double *        dst,
+  size_t          len);
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2021 Alexandros Theodotou <alex at zrythm dot org>
+ *
+ * This file is part of libaudec
+ *
+ * libaudec is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libaudec is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with libaudec.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * On-disk cache of seek indexes, so that files
+ * opened again in later sessions do not need to be
+ * scanned.
+ */
+
+#ifndef __AD_INDEX_CACHE_H__
+#define __AD_INDEX_CACHE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ad_seek_index.h"
+
+/**
+ * Sets the directory the indexes are stored in,
+ * creating it if needed.
+ *
+ * @param dir The directory, or NULL to disable the
+ *   cache.
+ *
+ * @return 0 if successful, -1 otherwise.
+ */
+int
+ad_index_cache_set_dir (
+  const char * dir);
+
+/**
+ * Returns whether a cache directory is set.
+ */
+int
+ad_index_cache_is_enabled (void);
+
+/**
+ * Loads the cached index of a file.
+ *
+ * The entry is only used if the file's path, size,
+ * modification time and a hash of its contents
+ * match the ones it was saved with.
+ *
+ * @param data The file's contents.
+ * @param total_samples Set to the number of
+ *   interleaved samples in the file.
+ * @param entries Set to a newly allocated array of
+ *   seek points.
+ *
+ * @return 0 if found, -1 otherwise.
+ */
+int
+ad_index_cache_load (
+  const char *      filename,
+  const uint8_t *   data,
+  size_t            size,
+  uint64_t *        total_samples,
+  ad_index_entry ** entries,
+  size_t *          num_entries);
+
+/**
+ * Saves the index of a file, replacing any
+ * previous one.
+ *
+ * @return 0 if successful, -1 otherwise.
+ */
+int
+ad_index_cache_save (
+  const char *           filename,
+  const uint8_t *        data,
+  size_t                 size,
+  uint64_t               total_samples,
+  const ad_index_entry * entries,
+  size_t                 num_entries);
+
+#endif
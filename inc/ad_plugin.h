@@ -78,6 +78,33 @@ typedef struct ad_plugin
   /** Opens the file. */
   void *  (*open)(const char *, AudecInfo *);
 
+  /** Optional, opens the file with
+   * AudecOpenFlags. If NULL, open is used and the
+   * flags are ignored. */
+  void *  (*open_with_flags)(
+    const char *, AudecInfo *, unsigned int);
+
+  /** Optional, opens a file held in memory, which
+   * stays valid until closed, with AudecOpenFlags.
+   * Returns NULL if the data is not in a format the
+   * backend decodes. */
+  void *  (*open_memory)(
+    const void *, size_t, AudecInfo *, unsigned int);
+
+  /** Optional, opens a file read through the
+   * callbacks, with the callbacks' user data and
+   * AudecOpenFlags. Returns NULL if the data is not
+   * in a format the backend decodes. */
+  void *  (*open_io)(
+    const AudecIO *, void *, AudecInfo *,
+    unsigned int);
+
+  /** Optional, opens a file from a descriptor,
+   * which stays open until closed, with
+   * AudecOpenFlags. Returns NULL if the data is not
+   * in a format the backend decodes. */
+  void *  (*open_fd)(int, AudecInfo *, unsigned int);
+
   /** Closes the file. */
   int     (*close)(void *);
 
@@ -91,6 +118,30 @@ typedef struct ad_plugin
    * argument into the float array and returns the number of
    * items read. */
   ssize_t (*read)(void *, float *, size_t);
+
+  /** Optional native readers for other sample
+   * formats, with the same semantics as read. If
+   * NULL, float samples are converted. */
+  ssize_t (*read_short)(void *, int16_t *, size_t);
+  ssize_t (*read_int)(void *, int32_t *, size_t);
+  ssize_t (*read_double)(void *, double *, size_t);
+
+  /** Optional, returns the file's interleaved
+   * float frames if they can be read in place, and
+   * sets the number of frames, or NULL. The frames
+   * stay valid until closed. */
+  const float * (*get_mapped_frames)(void *, int64_t *);
+
+  /** Optional, decodes the file from the start into
+   * the float array on the number of threads given
+   * as the 4th argument, up to as many frames as the
+   * 3rd argument. Returns the number of frames
+   * decoded, or the number of frames in the file if
+   * the array is NULL, or -1 if the file cannot be
+   * decoded in parallel. The read position is
+   * undefined afterwards. */
+  ssize_t (*read_parallel)(
+    void *, float *, size_t, unsigned int);
 } ad_plugin;
 
 int     ad_eval_null(const char *);
@@ -104,4 +155,5 @@ ssize_t ad_read_null(void *, float*, size_t);
 const ad_plugin * adp_get_sndfile();
 const ad_plugin * adp_get_ffmpeg();
 const ad_plugin * adp_get_minimp3();
+const ad_plugin * adp_get_pcm (void);
 #endif
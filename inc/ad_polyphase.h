@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2021 Alexandros Theodotou <alex at zrythm dot org>
+ *
+ * This file is part of libaudec
+ *
+ * libaudec is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libaudec is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with libaudec.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Polyphase FIR resampler for rational ratios.
+ */
+
+#ifndef __AD_POLYPHASE_H__
+#define __AD_POLYPHASE_H__
+
+#include <stddef.h>
+
+#include "audec/audec.h"
+
+typedef struct ad_polyphase ad_polyphase;
+
+/**
+ * Creates a resampler from \p in_rate to
+ * \p out_rate.
+ *
+ * Output frame k lies at input frame
+ * k * in_rate / out_rate, like libsamplerate's
+ * output.
+ *
+ * @param quality One of the polyphase qualities.
+ *
+ * @return the resampler, or NULL if the ratio does
+ *   not reduce to small enough integers or the
+ *   quality is not a polyphase quality.
+ */
+ad_polyphase *
+ad_polyphase_new (
+  unsigned int         channels,
+  unsigned int         in_rate,
+  unsigned int         out_rate,
+  AudecResampleQuality quality);
+
+/**
+ * Returns whether ad_polyphase_new() supports the
+ * given rates and quality.
+ */
+int
+ad_polyphase_supports (
+  unsigned int         in_rate,
+  unsigned int         out_rate,
+  AudecResampleQuality quality);
+
+/**
+ * Resamples interleaved frames.
+ *
+ * @param in Interleaved input frames.
+ * @param in_frames Number of frames in \p in.
+ * @param in_frames_used Set to the number of frames
+ *   consumed from \p in.
+ * @param out Interleaved output frames.
+ * @param out_frames Space in \p out, in frames.
+ * @param end_of_input Whether \p in holds the last
+ *   frames of the stream. The stream is then
+ *   flushed over one or more calls, until no more
+ *   frames are returned.
+ *
+ * @return Number of frames written to \p out.
+ */
+size_t
+ad_polyphase_process (
+  ad_polyphase * self,
+  const float *  in,
+  size_t         in_frames,
+  size_t *       in_frames_used,
+  float *        out,
+  size_t         out_frames,
+  int            end_of_input);
+
+/**
+ * Clears the filter history to start a new
+ * stream.
+ */
+void
+ad_polyphase_reset (
+  ad_polyphase * self);
+
+void
+ad_polyphase_free (
+  ad_polyphase * self);
+
+#endif
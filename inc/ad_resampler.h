@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2021 Alexandros Theodotou <alex at zrythm dot org>
+ *
+ * This file is part of libaudec
+ *
+ * libaudec is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libaudec is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with libaudec.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Push-mode resampler that uses the built-in
+ * polyphase engine for ratios it handles and
+ * libsamplerate otherwise.
+ */
+
+#ifndef __AD_RESAMPLER_H__
+#define __AD_RESAMPLER_H__
+
+#include <sys/types.h>
+
+#include "audec/audec.h"
+
+typedef struct ad_resampler ad_resampler;
+
+/**
+ * Returns the libsamplerate converter type for the
+ * given quality, or -1 if the quality is invalid.
+ */
+int
+ad_resampler_get_src_converter (
+  AudecResampleQuality quality);
+
+/**
+ * Creates a resampler from \p in_rate to
+ * \p out_rate, or reuses a pooled one with the
+ * same quality and channel count.
+ *
+ * @param variable_ratio Whether the ratio will be
+ *   changed with ad_resampler_set_ratio(), in which
+ *   case libsamplerate is always used.
+ *
+ * @return the resampler, or NULL on error.
+ */
+ad_resampler *
+ad_resampler_new (
+  AudecResampleQuality quality,
+  unsigned int         channels,
+  unsigned int         in_rate,
+  unsigned int         out_rate,
+  int                  variable_ratio);
+
+/**
+ * Resamples interleaved frames.
+ *
+ * @param in_frames_used Set to the number of frames
+ *   consumed from \p in.
+ * @param end_of_input Whether \p in holds the last
+ *   frames of the stream. Keep calling with no
+ *   input until no more frames are returned to
+ *   flush the resampler.
+ *
+ * @return Number of frames written to \p out, or
+ *   -1 on error.
+ */
+ssize_t
+ad_resampler_process (
+  ad_resampler * self,
+  const float *  in,
+  size_t         in_frames,
+  size_t *       in_frames_used,
+  float *        out,
+  size_t         out_frames,
+  int            end_of_input);
+
+/**
+ * Sets the ratio for the next calls to
+ * ad_resampler_process().
+ *
+ * libsamplerate moves smoothly from the previous
+ * ratio to the new one over the frames generated
+ * by the next call. Only valid for resamplers
+ * created with a variable ratio.
+ */
+void
+ad_resampler_set_ratio (
+  ad_resampler * self,
+  double         ratio);
+
+/**
+ * Clears the resampler state to start a new
+ * stream.
+ */
+void
+ad_resampler_reset (
+  ad_resampler * self);
+
+/**
+ * Releases the resampler. It is reset and kept in
+ * a process-wide pool for reuse by
+ * ad_resampler_new() if there is room, and freed
+ * otherwise.
+ */
+void
+ad_resampler_free (
+  ad_resampler * self);
+
+/**
+ * Sets how many idle resamplers the pool keeps,
+ * freeing any above the new size.
+ */
+void
+ad_resampler_set_pool_size (
+  size_t max_resamplers);
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2021 Alexandros Theodotou <alex at zrythm dot org>
+ *
+ * This file is part of libaudec
+ *
+ * libaudec is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libaudec is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with libaudec.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Compact seek index of compressed frames.
+ *
+ * Instead of a 16-byte entry per frame, the index
+ * keeps a checkpoint every few frames. Between
+ * checkpoints, offsets of contiguous frames are
+ * found again by reading the frame headers, and
+ * sample positions of frames with the usual
+ * length are implied. Other frames are stored as
+ * varint deltas.
+ */
+
+#ifndef __AD_SEEK_INDEX_H__
+#define __AD_SEEK_INDEX_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A seek point: the byte offset of a frame and the
+ * (interleaved) sample it starts at.
+ */
+typedef struct ad_index_entry
+{
+  uint64_t sample;
+  uint64_t offset;
+} ad_index_entry;
+
+/**
+ * Returns the size in bytes of the frame starting
+ * at \p frame, of which \p len bytes are
+ * available, or 0 if unknown.
+ */
+typedef size_t (*ad_frame_size_fn) (
+  const uint8_t * frame,
+  size_t          len,
+  void *          user_data);
+
+typedef struct ad_seek_index ad_seek_index;
+
+/**
+ * Creates a compact index from the full list of
+ * entries.
+ *
+ * @param data The file's contents, which must stay
+ *   valid while the index is used, or NULL to store
+ *   all offsets.
+ * @param frame_size Function returning the size of
+ *   a frame in \p data.
+ *
+ * @return the index, or NULL on error.
+ */
+ad_seek_index *
+ad_seek_index_new (
+  const ad_index_entry * entries,
+  size_t                 num_entries,
+  const uint8_t *        data,
+  size_t                 size,
+  ad_frame_size_fn       frame_size,
+  void *                 user_data);
+
+size_t
+ad_seek_index_get_num_entries (
+  const ad_seek_index * self);
+
+/**
+ * Returns the number of bytes the index takes.
+ */
+size_t
+ad_seek_index_get_memory_size (
+  const ad_seek_index * self);
+
+/**
+ * Returns the last entry whose sample is not after
+ * \p sample, or 0.
+ */
+size_t
+ad_seek_index_find (
+  const ad_seek_index * self,
+  uint64_t              sample);
+
+/**
+ * Expands \p num_entries entries starting from
+ * \p start.
+ *
+ * @return 0 if successful, -1 if the range is out
+ *   of bounds.
+ */
+int
+ad_seek_index_get_entries (
+  const ad_seek_index * self,
+  size_t                start,
+  size_t                num_entries,
+  ad_index_entry *      entries);
+
+void
+ad_seek_index_free (
+  ad_seek_index * self);
+
+#endif
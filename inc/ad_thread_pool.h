@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2021 Alexandros Theodotou <alex at zrythm dot org>
+ *
+ * This file is part of libaudec
+ *
+ * libaudec is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libaudec is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with libaudec.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Minimal worker pool for running a batch of
+ * independent tasks in parallel.
+ */
+
+#ifndef __AD_THREAD_POOL_H__
+#define __AD_THREAD_POOL_H__
+
+#include <stddef.h>
+
+typedef struct ad_thread_pool ad_thread_pool;
+
+/**
+ * Task function.
+ *
+ * @param data User data passed to
+ *   ad_thread_pool_run().
+ * @param task Index of the task, in
+ *   [0, num_tasks).
+ */
+typedef void (*ad_task_fn) (
+  void * data,
+  size_t task);
+
+/**
+ * Creates a pool that runs tasks on \p num_threads
+ * threads, including the thread calling
+ * ad_thread_pool_run().
+ *
+ * @return the pool, or NULL on error.
+ */
+ad_thread_pool *
+ad_thread_pool_new (
+  unsigned int num_threads);
+
+/**
+ * Runs \p num_tasks tasks and waits until all of
+ * them are done.
+ *
+ * Must not be called from several threads at the
+ * same time on the same pool.
+ */
+void
+ad_thread_pool_run (
+  ad_thread_pool * self,
+  ad_task_fn       fn,
+  void *           data,
+  size_t           num_tasks);
+
+/**
+ * Stops the worker threads and frees the pool.
+ */
+void
+ad_thread_pool_free (
+  ad_thread_pool * self);
+
+#endif
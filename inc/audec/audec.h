@@ -100,6 +100,117 @@ typedef enum AudecLogLevel
   AUDEC_LOG_LEVEL_TRACE,
 } AudecLogLevel;
 
+/**
+ * Callbacks for reading a file that is not on the
+ * filesystem, see \ref audec_open_io.
+ */
+typedef struct AudecIO
+{
+  /** Reads up to \p size bytes into \p buf and
+   * returns the number of bytes read, which is less
+   * than \p size only at the end of the file or on
+   * error. */
+  size_t  (*read) (
+    void *  buf,
+    size_t  size,
+    void *  user_data);
+
+  /** Moves to \p position bytes from the start of
+   * the file and returns 0 on success. */
+  int     (*seek) (
+    uint64_t position,
+    void *   user_data);
+
+  /** Optional, returns the size of the file in
+   * bytes, or -1 if unknown. Formats other than MP3
+   * can only be opened if it is set. */
+  int64_t (*get_size) (
+    void *  user_data);
+} AudecIO;
+
+/**
+ * Flags for \ref audec_open_with_flags.
+ */
+typedef enum AudecOpenFlags
+{
+  /** Do not scan the whole file at open time to
+   * index it (MP3 only).
+   *
+   * The length is read from the Xing/Info/LAME
+   * header if there is one, and otherwise estimated
+   * from the file size and bitrate, which is exact
+   * for CBR files. The seek index, and the exact
+   * length of files without a header, are worked
+   * out on the first seek. */
+  AUDEC_OPEN_LAZY_INDEX = 1 << 0,
+} AudecOpenFlags;
+
+/**
+ * Resampler quality.
+ *
+ * These map to the libsamplerate converter types,
+ * apart from the polyphase qualities.
+ */
+typedef enum AudecResampleQuality
+{
+  /** Band limited sinc interpolation, best
+   * quality (default). */
+  AUDEC_RESAMPLE_QUALITY_BEST,
+
+  /** Band limited sinc interpolation, medium
+   * quality. */
+  AUDEC_RESAMPLE_QUALITY_MEDIUM,
+
+  /** Band limited sinc interpolation, fastest. */
+  AUDEC_RESAMPLE_QUALITY_FASTEST,
+
+  /** Zero order hold interpolator, very fast but
+   * poor quality. */
+  AUDEC_RESAMPLE_QUALITY_ZERO_ORDER_HOLD,
+
+  /** Linear interpolator, very fast but poor
+   * quality. */
+  AUDEC_RESAMPLE_QUALITY_LINEAR,
+
+  /** Built-in polyphase filter, much faster than
+   * the sinc interpolators for ratios that reduce
+   * to small integers (such as 44.1k <-> 48k), with
+   * about 100 dB of stopband attenuation. Other
+   * ratios use \ref AUDEC_RESAMPLE_QUALITY_BEST. */
+  AUDEC_RESAMPLE_QUALITY_POLYPHASE_BEST,
+
+  /** Same as
+   * \ref AUDEC_RESAMPLE_QUALITY_POLYPHASE_BEST with
+   * a shorter filter of about 75 dB, falling back
+   * to \ref AUDEC_RESAMPLE_QUALITY_MEDIUM. */
+  AUDEC_RESAMPLE_QUALITY_POLYPHASE_MEDIUM,
+
+  /** Same as
+   * \ref AUDEC_RESAMPLE_QUALITY_POLYPHASE_BEST with
+   * a short filter and a wide transition band,
+   * falling back to
+   * \ref AUDEC_RESAMPLE_QUALITY_FASTEST. */
+  AUDEC_RESAMPLE_QUALITY_POLYPHASE_FASTEST,
+} AudecResampleQuality;
+
+/**
+ * Sample format of decoded data.
+ */
+typedef enum AudecSampleFormat
+{
+  /** 32-bit float in [-1, 1]. */
+  AUDEC_SAMPLE_FORMAT_FLOAT,
+
+  /** Signed 16-bit integer. */
+  AUDEC_SAMPLE_FORMAT_S16,
+
+  /** Signed 32-bit integer. */
+  AUDEC_SAMPLE_FORMAT_S32,
+
+  /** 64-bit float in [-1, 1]. */
+  AUDEC_SAMPLE_FORMAT_DOUBLE,
+} AudecSampleFormat;
+
 /**
  * Logging function prototype.
  */
@@ -117,6 +228,47 @@ AUDEC_SYMBOL_EXPORT
 void
 audec_init (void);
 
+/**
+ * Set how many idle resamplers are kept for reuse.
+ *
+ * Resamplers released by handles are reset and
+ * kept in a process-wide pool keyed by quality and
+ * channel count, and reused by later handles. This
+ * saves setting up a converter for every file when
+ * resampling many short files. Defaults to 16.
+ *
+ * @param max_resamplers Maximum number of idle
+ *   resamplers to keep. 0 frees all of them and
+ *   disables pooling.
+ */
+AUDEC_SYMBOL_EXPORT
+void
+audec_set_resampler_pool_size (
+  size_t max_resamplers);
+
+/**
+ * Set a directory to cache MP3 seek indexes in.
+ *
+ * Opening an MP3 scans the whole file to index its
+ * frames. With a cache directory set, the index is
+ * saved there and later opens of the same file,
+ * including in later sessions, load it instead of
+ * scanning. An index is only used if the file's
+ * path, size, modification time and a hash of its
+ * contents still match.
+ *
+ * The cache is disabled by default.
+ *
+ * @param dir The directory, which is created if it
+ *   does not exist, or NULL to disable the cache.
+ *
+ * @return 0 if successful, non-zero otherwise.
+ */
+AUDEC_SYMBOL_EXPORT
+int
+audec_set_index_cache_dir (
+  const char * dir);
+
 /**
  * Open an audio file.
  *
@@ -133,6 +285,93 @@ audec_open (
   const char * filename,
   AudecInfo *  nfo);
 
+/**
+ * Open an audio file with \ref AudecOpenFlags.
+ *
+ * Same as \ref audec_open otherwise. Flags that do
+ * not apply to the file's format are ignored.
+ *
+ * @param flags Bitwise OR of \ref AudecOpenFlags.
+ */
+AUDEC_SYMBOL_EXPORT
+AudecHandle *
+audec_open_with_flags (
+  const char *   filename,
+  AudecInfo *    nfo,
+  unsigned int   flags);
+
+/**
+ * Open an audio file held in memory.
+ *
+ * The data is decoded without copying it to a
+ * temporary file, so it can come straight from a
+ * memory-mapped archive. The format is detected
+ * from the contents, and the backends are tried in
+ * the same order of preference as for files opened
+ * by name.
+ *
+ * @param data The file's contents, which must stay
+ *   valid until the handle is closed.
+ * @param size Size of \p data in bytes.
+ * @param flags Bitwise OR of \ref AudecOpenFlags.
+ *
+ * @return NULL on error, a handle otherwise.
+ */
+AUDEC_SYMBOL_EXPORT
+AudecHandle *
+audec_open_memory (
+  const void *   data,
+  size_t         size,
+  AudecInfo *    nfo,
+  unsigned int   flags);
+
+/**
+ * Open an audio file read through callbacks.
+ *
+ * The format is detected from the contents, as
+ * with \ref audec_open_memory. The callbacks may
+ * be called again after a backend failed to
+ * recognize the data, so they must be able to seek
+ * back to the start.
+ *
+ * @param io Callbacks, copied by the handle.
+ * @param user_data Passed to the callbacks, which
+ *   are called until the handle is closed.
+ * @param flags Bitwise OR of \ref AudecOpenFlags.
+ *
+ * @return NULL on error, a handle otherwise.
+ */
+AUDEC_SYMBOL_EXPORT
+AudecHandle *
+audec_open_io (
+  const AudecIO * io,
+  void *          user_data,
+  AudecInfo *     nfo,
+  unsigned int    flags);
+
+/**
+ * Open an audio file from a file descriptor.
+ *
+ * The format is detected from the contents, as
+ * with \ref audec_open_memory. The descriptor must
+ * be at the start of the file. Descriptors that
+ * cannot seek, such as pipes, are only tried with
+ * libsndfile, so they cannot be used for MP3.
+ *
+ * @param fd The descriptor, which is not closed by
+ *   the handle and must stay open until the handle
+ *   is closed.
+ * @param flags Bitwise OR of \ref AudecOpenFlags.
+ *
+ * @return NULL on error, a handle otherwise.
+ */
+AUDEC_SYMBOL_EXPORT
+AudecHandle *
+audec_open_fd (
+  int            fd,
+  AudecInfo *    nfo,
+  unsigned int   flags);
+
 /**
  * Close an audio file and release decoder structures.
  *
@@ -150,6 +389,8 @@ audec_close (
  * @param handle Decoder handle.
  * @param pos frame position to seek to in frames (1 frame =
  * number-of-channel samples) from the start of the file.
+ * This is always in frames at the file's sample rate.
+ * The state of the streaming resampler is reset.
  *
  * @return the current position in frames (multi-channel
  * samples) from the start of the file. On error this
@@ -162,9 +403,12 @@ audec_seek (
   int64_t       pos);
 
 /**
- * Decode audio data chunk to raw interleaved channel
+ * Decode the whole file to raw interleaved channel
  * floating point data.
  *
+ * This is a wrapper over \ref audec_read_into that
+ * allocates the output buffer.
+ *
  * @param handle decoder handle
  * @param out Memory location to store output data.
  * the memory this points to will be allocated. The
@@ -173,7 +417,8 @@ audec_seek (
  * @param sample_rate Sample rate to resample to. If
  * this is negative or if the file's sample rate is
  * the same as the given sample rate no resampling
- * will be done.
+ * will be done. The quality set with
+ * \ref audec_set_resample_quality is used.
  *
  * @return the total number of read samples for each
  * channel.
@@ -185,6 +430,588 @@ audec_read (
   float **      out,
   int           sample_rate);
 
+/**
+ * Returns the file's frames without decoding or
+ * copying them, when the file stores them as
+ * interleaved 32-bit floats in the host's byte
+ * order.
+ *
+ * The frames are read straight from the file
+ * mapped into memory, so they only take up space
+ * in the page cache, which is shared with other
+ * processes mapping the same file.
+ *
+ * They are the frames \ref audec_read returns
+ * without resampling. The read position is not
+ * changed.
+ *
+ * @param handle Decoder handle.
+ * @param num_frames Set to the number of frames.
+ *
+ * @return a read-only pointer to the frames, valid
+ *   until the handle is closed, or NULL if the
+ *   frames are stored differently, or if a gain,
+ *   channel selection or mix matrix is set on the
+ *   handle.
+ */
+AUDEC_SYMBOL_EXPORT
+const float *
+audec_get_mapped_frames (
+  AudecHandle * handle,
+  int64_t *     num_frames);
+
+/**
+ * Decode the whole file once and resample it to
+ * several sample rates.
+ *
+ * Every decoded block is fed to one resampler per
+ * rate, so the file is only decoded once. With
+ * \ref audec_set_resample_threads set above 1, the
+ * rates are resampled in parallel.
+ *
+ * Each output is the same as what \ref audec_read
+ * returns for that rate.
+ *
+ * @param handle Decoder handle.
+ * @param sample_rates Sample rates to resample to.
+ *   A negative rate or the file's rate returns the
+ *   frames as decoded.
+ * @param num_rates Number of sample rates.
+ * @param out Array of \p num_rates pointers that
+ *   must be NULL. Each is set to an allocated
+ *   buffer of interleaved frames, to be free()'d by
+ *   the caller.
+ * @param num_frames Array of \p num_rates counts,
+ *   set to the number of frames in each output.
+ *
+ * @return 0 on success, -1 on error.
+ */
+AUDEC_SYMBOL_EXPORT
+int
+audec_read_multi_rate (
+  AudecHandle * handle,
+  const int *   sample_rates,
+  size_t        num_rates,
+  float **      out,
+  ssize_t *     num_frames);
+
+/**
+ * Returns the number of frames the file has at the
+ * given sample rate.
+ *
+ * This is the number of frames a buffer passed to
+ * \ref audec_read_into must be able to hold.
+ *
+ * @param handle Decoder handle.
+ * @param sample_rate Sample rate to resample to, or
+ *   a negative number for the file's sample rate.
+ *
+ * @return the number of frames, or -1 on error.
+ */
+AUDEC_SYMBOL_EXPORT
+ssize_t
+audec_get_num_frames (
+  AudecHandle * handle,
+  int           sample_rate);
+
+/**
+ * Make whole-file reads return an exact number of
+ * frames.
+ *
+ * When enabled, \ref audec_get_num_frames returns
+ * exactly ceil (frames * ratio), computed with
+ * integer maths, and \ref audec_read,
+ * \ref audec_read_into,
+ * \ref audec_read_into_planar and
+ * \ref audec_read_multi_rate return exactly that
+ * many frames. The resampler is flushed at the end
+ * of the file and any frames it does not produce
+ * are filled with silence.
+ *
+ * The output is always aligned to time zero: frame
+ * k lies at k / sample_rate seconds, without any
+ * filter delay.
+ *
+ * @param handle Decoder handle.
+ * @param exact Whether to enable exact lengths.
+ *   Disabled by default, in which case the length
+ *   is rounded down with floating point maths.
+ *
+ * @return 0 on success, -1 on error.
+ */
+AUDEC_SYMBOL_EXPORT
+int
+audec_set_exact_length (
+  AudecHandle * handle,
+  int           exact);
+
+/**
+ * Decode the whole file to raw interleaved channel
+ * floating point data into a caller-provided buffer.
+ *
+ * Decoding starts from the beginning of the file
+ * and goes through the handle's streaming
+ * resampler, so apart from the resampler state
+ * created on first use no memory is allocated,
+ * except in these cases:
+ * - When resampling with
+ *   \ref audec_set_resample_threads above 1, the
+ *   whole file is first decoded into an allocated
+ *   buffer, and each thread allocates its own
+ *   working buffers.
+ * - When not resampling with
+ *   \ref audec_set_decode_threads above 1, each
+ *   decoding thread allocates its own decoder
+ *   state.
+ *
+ * @param handle Decoder handle.
+ * @param out Buffer to write to. Must hold at least
+ *   \p max_frames times the number of channels
+ *   samples.
+ * @param max_frames Capacity of \p out in frames.
+ *   Use \ref audec_get_num_frames to find out how
+ *   many frames are needed.
+ * @param sample_rate Sample rate to resample to. If
+ *   this is negative or if the file's sample rate is
+ *   the same as the given sample rate no resampling
+ *   will be done.
+ *
+ * @return the number of frames written, or -1 on
+ * error.
+ */
+AUDEC_SYMBOL_EXPORT
+ssize_t
+audec_read_into (
+  AudecHandle * handle,
+  float *       out,
+  size_t        max_frames,
+  int           sample_rate);
+
+/**
+ * Decode the frames in [\p start, \p end) to raw
+ * interleaved channel floating point data into a
+ * caller-provided buffer.
+ *
+ * When resampling, decoding starts a little before
+ * \p start so that the resampler's filter history
+ * and phase match a render of the whole file, and
+ * the output frames are the ones from such a render
+ * that lie in the range. Their number is
+ * ceil (end * sample_rate / file_rate) -
+ * ceil (start * sample_rate / file_rate).
+ *
+ * @param handle Decoder handle.
+ * @param out Buffer to write to. Must hold at least
+ *   \p max_frames times the number of channels
+ *   samples.
+ * @param max_frames Capacity of \p out in frames.
+ * @param start First frame of the range, at the
+ *   file's sample rate.
+ * @param end Frame after the last frame of the
+ *   range, at the file's sample rate.
+ * @param sample_rate Sample rate to resample to. If
+ *   this is negative or if the file's sample rate is
+ *   the same as the given sample rate no resampling
+ *   will be done.
+ *
+ * @return the number of frames written, or -1 on
+ * error.
+ */
+AUDEC_SYMBOL_EXPORT
+ssize_t
+audec_read_range (
+  AudecHandle * handle,
+  float *       out,
+  size_t        max_frames,
+  int64_t       start,
+  int64_t       end,
+  int           sample_rate);
+
+/**
+ * Decode the next chunk of audio from the current
+ * position into a caller-owned buffer of raw
+ * interleaved channel floating point data.
+ *
+ * Successive calls continue where the previous call
+ * stopped, so a file can be streamed in blocks of
+ * any size without holding it in memory. Use
+ * \ref audec_seek to change the position.
+ *
+ * If a target sample rate was set with
+ * \ref audec_set_target_sample_rate, the frames are
+ * resampled by a resampler that is kept on the
+ * handle, so successive chunks form one continuous
+ * stream.
+ *
+ * @param handle Decoder handle.
+ * @param dst Buffer to write to. Must hold at least
+ *   \p max_frames times the number of channels
+ *   samples.
+ * @param max_frames Maximum number of frames to
+ *   read.
+ *
+ * @return the number of frames read, 0 at the end
+ * of the file, or -1 on error.
+ */
+AUDEC_SYMBOL_EXPORT
+ssize_t
+audec_read_frames (
+  AudecHandle * handle,
+  float *       dst,
+  size_t        max_frames);
+
+/**
+ * Like \ref audec_read_frames, but writes samples
+ * in the given format.
+ *
+ * When no resampling is done, the backend's native
+ * reader for the format is used if it has one (for
+ * example sf_read_short() for files read with
+ * libsndfile), otherwise float samples are
+ * converted block by block.
+ *
+ * @param handle Decoder handle.
+ * @param dst Buffer to write to. Must hold at least
+ *   \p max_frames times the number of channels
+ *   samples of the given format.
+ * @param max_frames Maximum number of frames to
+ *   read.
+ * @param format Sample format to write.
+ *
+ * @return the number of frames read, 0 at the end
+ * of the file, or -1 on error.
+ */
+AUDEC_SYMBOL_EXPORT
+ssize_t
+audec_read_frames_format (
+  AudecHandle *     handle,
+  void *            dst,
+  size_t            max_frames,
+  AudecSampleFormat format);
+
+/**
+ * Like \ref audec_read_frames, but downmixes all
+ * channels to mono.
+ *
+ * Channels are averaged block by block straight
+ * after decoding (and resampling).
+ *
+ * @param handle Decoder handle.
+ * @param dst Buffer of at least \p max_frames
+ *   samples to write to.
+ * @param max_frames Maximum number of frames to
+ *   read.
+ *
+ * @return the number of frames read, 0 at the end
+ * of the file, or -1 on error.
+ */
+AUDEC_SYMBOL_EXPORT
+ssize_t
+audec_read_frames_mono (
+  AudecHandle * handle,
+  float *       dst,
+  size_t        max_frames);
+
+/**
+ * Same as \ref audec_read_frames_mono but writes
+ * doubles. The channels are summed in double
+ * precision.
+ */
+AUDEC_SYMBOL_EXPORT
+ssize_t
+audec_read_frames_mono_dbl (
+  AudecHandle * handle,
+  double *      dst,
+  size_t        max_frames);
+
+/**
+ * Like \ref audec_read_frames, but writes one
+ * contiguous buffer per channel instead of
+ * interleaved frames.
+ *
+ * Frames are deinterleaved block by block right
+ * after decoding (and resampling), so no extra pass
+ * over the whole output is needed.
+ *
+ * @param handle Decoder handle.
+ * @param dst One buffer per channel, each holding
+ *   at least \p max_frames samples. They can be
+ *   aligned by the caller as needed.
+ * @param max_frames Maximum number of frames to
+ *   read.
+ *
+ * @return the number of frames read, 0 at the end
+ * of the file, or -1 on error.
+ */
+AUDEC_SYMBOL_EXPORT
+ssize_t
+audec_read_frames_planar (
+  AudecHandle *   handle,
+  float * const * dst,
+  size_t          max_frames);
+
+/**
+ * Like \ref audec_read_into, but writes one
+ * contiguous buffer per channel instead of
+ * interleaved frames.
+ *
+ * @param handle Decoder handle.
+ * @param out One buffer per channel, each holding
+ *   at least \p max_frames samples.
+ * @param max_frames Capacity of each of \p out in
+ *   frames.
+ * @param sample_rate Sample rate to resample to. If
+ *   this is negative or if the file's sample rate is
+ *   the same as the given sample rate no resampling
+ *   will be done.
+ *
+ * @return the number of frames written, or -1 on
+ * error.
+ */
+AUDEC_SYMBOL_EXPORT
+ssize_t
+audec_read_into_planar (
+  AudecHandle *   handle,
+  float * const * out,
+  size_t          max_frames,
+  int             sample_rate);
+
+/**
+ * Set the sample rate that \ref audec_read_frames
+ * resamples to.
+ *
+ * @param handle Decoder handle.
+ * @param sample_rate Sample rate to resample to. If
+ *   this is negative or if the file's sample rate is
+ *   the same as the given sample rate no resampling
+ *   will be done.
+ *
+ * @return 0 on success, -1 if the sample rate
+ * change, combined with the speed set by
+ * \ref audec_set_varispeed, is out of range.
+ */
+AUDEC_SYMBOL_EXPORT
+int
+audec_set_target_sample_rate (
+  AudecHandle * handle,
+  int           sample_rate);
+
+/**
+ * Set the number of frames processed at a time.
+ *
+ * Reads run decoding, channel selection or mixing,
+ * gain, resampling and sample format conversion
+ * over blocks of this many frames, so that the
+ * data stays in cache between stages. Larger
+ * blocks have less overhead per block, smaller
+ * ones fit in smaller caches.
+ *
+ * @param handle Decoder handle.
+ * @param block_size Frames per block, between 256
+ *   and 65536. Defaults to 4096.
+ *
+ * @return 0 on success, -1 if the block size is
+ *   out of range.
+ */
+AUDEC_SYMBOL_EXPORT
+int
+audec_set_block_size (
+  AudecHandle * handle,
+  size_t        block_size);
+
+/**
+ * Set a gain to apply to decoded frames.
+ *
+ * The gain is applied to each block right after
+ * decoding and mixing, before resampling, so it
+ * does not take another pass over the output.
+ *
+ * @param handle Decoder handle.
+ * @param gain Linear gain. Defaults to 1.
+ *
+ * @return 0 on success, -1 on error.
+ */
+AUDEC_SYMBOL_EXPORT
+int
+audec_set_gain (
+  AudecHandle * handle,
+  float         gain);
+
+/**
+ * Set the playback speed of streamed reads.
+ *
+ * Frames returned by \ref audec_read_frames (and
+ * the other streamed reads) are played back at
+ * \p speed times the normal rate: 2.0 plays twice
+ * as fast and returns half as many frames. The
+ * speed can be changed between any two reads. The
+ * resampler keeps its state and moves smoothly
+ * from the previous ratio to the new one over the
+ * next frames it generates, so it can be used for
+ * scrubbing and tape-style varispeed.
+ *
+ * Once called, streamed reads always go through a
+ * variable ratio libsamplerate converter, even at
+ * the file's sample rate and a speed of 1.0.
+ * Whole-file reads such as \ref audec_read_into
+ * ignore the speed.
+ *
+ * @param handle Decoder handle.
+ * @param speed Playback speed, greater than 0.
+ *
+ * @return 0 on success, -1 if the speed is out of
+ *   the resampler's range.
+ */
+AUDEC_SYMBOL_EXPORT
+int
+audec_set_varispeed (
+  AudecHandle * handle,
+  double        speed);
+
+/**
+ * Set the number of threads used to resample.
+ *
+ * With more than one thread, the output channels
+ * are split into groups that are resampled by
+ * separate converters on a worker pool and joined
+ * into the output, so resampling files with many
+ * channels scales across cores. The output is the
+ * same as when resampling on one thread.
+ *
+ * audec_read_into() and audec_read() instead
+ * split long files into time segments that
+ * overlap by the filter length, resample each one
+ * on its own thread and stitch them together. The
+ * result matches a single pass to within 1e-4.
+ *
+ * @param handle Decoder handle.
+ * @param num_threads Number of threads, 1 (the
+ *   default) to resample on the calling thread
+ *   only. At most one thread per output channel is
+ *   used.
+ *
+ * @return 0 on success, -1 on error.
+ */
+AUDEC_SYMBOL_EXPORT
+int
+audec_set_resample_threads (
+  AudecHandle * handle,
+  unsigned int  num_threads);
+
+/**
+ * Set the number of threads whole-file reads
+ * decode on.
+ *
+ * audec_read_into() and audec_read() then split
+ * the file into as many ranges, decode each range
+ * on its own thread straight into its part of the
+ * output, and give the same samples as decoding on
+ * one thread. When resampling, this only applies
+ * if audec_set_resample_threads() is also used,
+ * since the file is otherwise streamed through the
+ * resampler. Each
+ * thread decodes a few frames before its range to
+ * rebuild the decoder state, so short files are
+ * decoded on fewer threads.
+ *
+ * Only MP3 files support this, other files are
+ * decoded on the calling thread. Selecting or
+ * mixing channels also disables it.
+ *
+ * @param handle Decoder handle.
+ * @param num_threads Number of threads, 1 (the
+ *   default) to decode on the calling thread only.
+ *
+ * @return 0 on success, -1 on error.
+ */
+AUDEC_SYMBOL_EXPORT
+int
+audec_set_decode_threads (
+  AudecHandle * handle,
+  unsigned int  num_threads);
+
+/**
+ * Only decode the given channels of the file.
+ *
+ * Channels are picked block by block straight after
+ * decoding, before resampling, so the resampler and
+ * the output only carry the selected channels. All
+ * read functions return frames with the selected
+ * channels. This replaces any mix matrix and resets
+ * the streaming resampler.
+ *
+ * @param handle Decoder handle.
+ * @param channels Index of the file channel to use
+ *   for each output channel, or NULL to use all the
+ *   channels of the file.
+ * @param num_channels Number of output channels.
+ *
+ * @return 0 on success, -1 if a channel is out of
+ * range.
+ */
+AUDEC_SYMBOL_EXPORT
+int
+audec_set_channel_selection (
+  AudecHandle *        handle,
+  const unsigned int * channels,
+  unsigned int         num_channels);
+
+/**
+ * Mix the channels of the file through a matrix.
+ *
+ * Like \ref audec_set_channel_selection, mixing is
+ * done block by block before resampling. This
+ * replaces any channel selection and resets the
+ * streaming resampler.
+ *
+ * @param handle Decoder handle.
+ * @param matrix Gain of each file channel for each
+ *   output channel: \p num_channels rows of as many
+ *   columns as the file has channels. The matrix is
+ *   copied. Pass NULL to use all the channels of the
+ *   file unmixed.
+ * @param num_channels Number of output channels.
+ *
+ * @return 0 on success, -1 on error.
+ */
+AUDEC_SYMBOL_EXPORT
+int
+audec_set_mix_matrix (
+  AudecHandle * handle,
+  const float * matrix,
+  unsigned int  num_channels);
+
+/**
+ * Returns the number of channels in the frames
+ * returned by read functions, after channel
+ * selection or mixing.
+ */
+AUDEC_SYMBOL_EXPORT
+unsigned int
+audec_get_output_channels (
+  AudecHandle * handle);
+
+/**
+ * Set the resampler quality used by this handle.
+ *
+ * Lower qualities are several times faster and are
+ * suitable for previews. Changing the quality
+ * resets the streaming resampler used by
+ * \ref audec_read_frames.
+ *
+ * @param handle Decoder handle.
+ * @param quality Resampler quality. Defaults to
+ *   \ref AUDEC_RESAMPLE_QUALITY_BEST.
+ *
+ * @return 0 on success, -1 if the quality is
+ * invalid.
+ */
+AUDEC_SYMBOL_EXPORT
+int
+audec_set_resample_quality (
+  AudecHandle *        handle,
+  AudecResampleQuality quality);
+
 /**
  * Re-read the file information and meta-data.
  *
@@ -238,13 +1065,37 @@ audec_finfo (
   AudecInfo *  nfo);
 
 /**
- * Wrapper around \ref audec_read, downmixes all channels to
- * mono.
+ * Decode the file from the start and downmix all
+ * channels to mono.
+ *
+ * Frames are streamed through
+ * \ref audec_read_frames_mono_dbl, which allocates
+ * scratch space and, when resampling, the
+ * streaming resampler on the handle the first time
+ * they are needed. The handle is rewound first and
+ * left at the end of the file, so use each handle
+ * from one thread at a time.
+ *
+ * @param handle Decoder handle.
+ * @param nfo Unused.
+ * @param d Buffer to write to.
+ * @param len Capacity of \p d in frames.
+ * @param sample_rate Sample rate to resample to. If
+ *   this is negative or if the file's sample rate is
+ *   the same as the given sample rate no resampling
+ *   will be done.
+ *
+ * @return the number of frames written, or -1 on
+ * error.
  */
 AUDEC_SYMBOL_EXPORT
 ssize_t
 audec_read_mono_dbl (
-  void *, AudecInfo *, double*, size_t, int);
+  AudecHandle * handle,
+  AudecInfo *   nfo,
+  double *      d,
+  size_t        len,
+  int           sample_rate);
 
 /**
  * Calls dbg() to print file info to stderr.
@@ -0,0 +1,696 @@
+/*
+ * Copyright (C) 2021 Alexandros Theodotou <alex at zrythm dot org>
+ *
+ * This file is part of libaudec
+ *
+ * libaudec is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libaudec is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with libaudec.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined (__SSE__)
+#include <xmmintrin.h>
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+#elif defined (__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined (__BYTE_ORDER__) && \
+  __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+/** Little-endian samples can be loaded as they
+ * are. */
+#define HOST_LITTLE_ENDIAN 1
+#endif
+
+#include "ad_dsp.h"
+
+void
+ad_deinterleave (
+  const float *   src,
+  float * const * dst,
+  size_t          dst_offset,
+  unsigned int    channels,
+  size_t          frames)
+{
+  size_t i = 0;
+
+  if (channels == 1)
+    {
+      float * d = dst[0] + dst_offset;
+      for (i = 0; i < frames; i++)
+        d[i] = src[i];
+      return;
+    }
+
+  if (channels == 2)
+    {
+      float * l = dst[0] + dst_offset;
+      float * r = dst[1] + dst_offset;
+#if defined (__SSE__)
+      for (; i + 4 <= frames; i += 4)
+        {
+          __m128 a = _mm_loadu_ps (&src[i * 2]);
+          __m128 b = _mm_loadu_ps (&src[i * 2 + 4]);
+          _mm_storeu_ps (
+            &l[i],
+            _mm_shuffle_ps (a, b, _MM_SHUFFLE (2, 0, 2, 0)));
+          _mm_storeu_ps (
+            &r[i],
+            _mm_shuffle_ps (a, b, _MM_SHUFFLE (3, 1, 3, 1)));
+        }
+#elif defined (__ARM_NEON)
+      for (; i + 4 <= frames; i += 4)
+        {
+          float32x4x2_t lr = vld2q_f32 (&src[i * 2]);
+          vst1q_f32 (&l[i], lr.val[0]);
+          vst1q_f32 (&r[i], lr.val[1]);
+        }
+#endif
+      for (; i < frames; i++)
+        {
+          l[i] = src[i * 2];
+          r[i] = src[i * 2 + 1];
+        }
+      return;
+    }
+
+  /* one pass per channel keeps each write stream
+   * sequential */
+  for (unsigned int c = 0; c < channels; c++)
+    {
+      float * d = dst[c] + dst_offset;
+      const float * s = src + c;
+      for (i = 0; i < frames; i++)
+        d[i] = s[i * channels];
+    }
+}
+
+void
+ad_select_channels (
+  const float *        src,
+  unsigned int         in_channels,
+  float *              dst,
+  const unsigned int * map,
+  unsigned int         out_channels,
+  size_t               frames)
+{
+  for (unsigned int c = 0; c < out_channels; c++)
+    {
+      const float * s = src + map[c];
+      float * d = dst + c;
+      for (size_t i = 0; i < frames; i++)
+        d[i * out_channels] = s[i * in_channels];
+    }
+}
+
+void
+ad_select_channels_range (
+  const float *  src,
+  unsigned int   in_channels,
+  float *        dst,
+  unsigned int   first_channel,
+  unsigned int   num_channels,
+  size_t         frames)
+{
+  src += first_channel;
+  for (size_t i = 0; i < frames; i++)
+    {
+      for (unsigned int c = 0; c < num_channels; c++)
+        dst[i * num_channels + c] = src[i * in_channels + c];
+    }
+}
+
+void
+ad_interleave_channels (
+  const float *  src,
+  unsigned int   num_channels,
+  float *        dst,
+  unsigned int   first_channel,
+  unsigned int   out_channels,
+  size_t         frames)
+{
+  dst += first_channel;
+  for (size_t i = 0; i < frames; i++)
+    {
+      for (unsigned int c = 0; c < num_channels; c++)
+        dst[i * out_channels + c] = src[i * num_channels + c];
+    }
+}
+
+void
+ad_mix_channels (
+  const float *  src,
+  unsigned int   in_channels,
+  float *        dst,
+  const float *  matrix,
+  unsigned int   out_channels,
+  size_t         frames)
+{
+  for (size_t i = 0; i < frames; i++)
+    {
+      const float * in = &src[i * in_channels];
+      float * out = &dst[i * out_channels];
+      for (unsigned int o = 0; o < out_channels; o++)
+        {
+          const float * row = &matrix[o * in_channels];
+          float sum = 0.f;
+          for (unsigned int c = 0; c < in_channels; c++)
+            sum += row[c] * in[c];
+          out[o] = sum;
+        }
+    }
+}
+
+void
+ad_downmix_mono (
+  const float * src,
+  float *       dst,
+  unsigned int  channels,
+  size_t        frames)
+{
+  size_t i = 0;
+
+  if (channels == 2)
+    {
+#if defined (__SSE__)
+      const __m128 half = _mm_set1_ps (0.5f);
+      for (; i + 4 <= frames; i += 4)
+        {
+          __m128 a = _mm_loadu_ps (&src[i * 2]);
+          __m128 b = _mm_loadu_ps (&src[i * 2 + 4]);
+          __m128 sum =
+            _mm_add_ps (
+              _mm_shuffle_ps (
+                a, b, _MM_SHUFFLE (2, 0, 2, 0)),
+              _mm_shuffle_ps (
+                a, b, _MM_SHUFFLE (3, 1, 3, 1)));
+          _mm_storeu_ps (&dst[i], _mm_mul_ps (sum, half));
+        }
+#elif defined (__ARM_NEON)
+      for (; i + 4 <= frames; i += 4)
+        {
+          float32x4x2_t lr = vld2q_f32 (&src[i * 2]);
+          vst1q_f32 (
+            &dst[i],
+            vmulq_n_f32 (
+              vaddq_f32 (lr.val[0], lr.val[1]), 0.5f));
+        }
+#endif
+      for (; i < frames; i++)
+        dst[i] = (src[i * 2] + src[i * 2 + 1]) * 0.5f;
+      return;
+    }
+
+  /* accumulate one channel at a time so that the
+   * inner loops vectorize */
+  const float gain = 1.f / (float) channels;
+  for (i = 0; i < frames; i++)
+    dst[i] = src[i * channels];
+  for (unsigned int c = 1; c < channels; c++)
+    {
+      const float * s = src + c;
+      for (i = 0; i < frames; i++)
+        dst[i] += s[i * channels];
+    }
+  for (i = 0; i < frames; i++)
+    dst[i] *= gain;
+}
+
+void
+ad_downmix_mono_dbl (
+  const float * src,
+  double *      dst,
+  unsigned int  channels,
+  size_t        frames)
+{
+  size_t i = 0;
+
+  if (channels == 2)
+    {
+#if defined (__SSE2__)
+      const __m128d half = _mm_set1_pd (0.5);
+      for (; i + 2 <= frames; i += 2)
+        {
+          __m128 a = _mm_loadu_ps (&src[i * 2]);
+          __m128d lr0 = _mm_cvtps_pd (a);
+          __m128d lr1 =
+            _mm_cvtps_pd (_mm_movehl_ps (a, a));
+          __m128d sum =
+            _mm_add_pd (
+              _mm_unpacklo_pd (lr0, lr1),
+              _mm_unpackhi_pd (lr0, lr1));
+          _mm_storeu_pd (&dst[i], _mm_mul_pd (sum, half));
+        }
+#elif defined (__ARM_NEON) && defined (__aarch64__)
+      for (; i + 2 <= frames; i += 2)
+        {
+          float32x2x2_t lr = vld2_f32 (&src[i * 2]);
+          vst1q_f64 (
+            &dst[i],
+            vmulq_n_f64 (
+              vaddq_f64 (
+                vcvt_f64_f32 (lr.val[0]),
+                vcvt_f64_f32 (lr.val[1])),
+              0.5));
+        }
+#endif
+      for (; i < frames; i++)
+        dst[i] =
+          ((double) src[i * 2] +
+           (double) src[i * 2 + 1]) * 0.5;
+      return;
+    }
+
+  const double gain = 1.0 / (double) channels;
+  for (i = 0; i < frames; i++)
+    dst[i] = (double) src[i * channels];
+  for (unsigned int c = 1; c < channels; c++)
+    {
+      const float * s = src + c;
+      for (i = 0; i < frames; i++)
+        dst[i] += (double) s[i * channels];
+    }
+  for (i = 0; i < frames; i++)
+    dst[i] *= gain;
+}
+
+void
+ad_apply_gain (
+  float *        buf,
+  size_t         len,
+  float          gain)
+{
+  size_t i = 0;
+
+#if defined (__SSE__)
+  const __m128 g = _mm_set1_ps (gain);
+  for (; i + 4 <= len; i += 4)
+    _mm_storeu_ps (
+      &buf[i], _mm_mul_ps (_mm_loadu_ps (&buf[i]), g));
+#elif defined (__ARM_NEON)
+  for (; i + 4 <= len; i += 4)
+    vst1q_f32 (
+      &buf[i], vmulq_n_f32 (vld1q_f32 (&buf[i]), gain));
+#endif
+  for (; i < len; i++)
+    buf[i] *= gain;
+}
+
+float
+ad_dot_product (
+  const float *  a,
+  const float *  b,
+  size_t         len)
+{
+  size_t i = 0;
+  float sum = 0.f;
+
+#if defined (__SSE__)
+  /* two accumulators to hide the add latency */
+  __m128 acc0 = _mm_setzero_ps ();
+  __m128 acc1 = _mm_setzero_ps ();
+  for (; i + 8 <= len; i += 8)
+    {
+      acc0 =
+        _mm_add_ps (
+          acc0,
+          _mm_mul_ps (
+            _mm_loadu_ps (&a[i]), _mm_loadu_ps (&b[i])));
+      acc1 =
+        _mm_add_ps (
+          acc1,
+          _mm_mul_ps (
+            _mm_loadu_ps (&a[i + 4]),
+            _mm_loadu_ps (&b[i + 4])));
+    }
+  acc0 = _mm_add_ps (acc0, acc1);
+  float tmp[4];
+  _mm_storeu_ps (tmp, acc0);
+  sum = (tmp[0] + tmp[1]) + (tmp[2] + tmp[3]);
+#elif defined (__ARM_NEON)
+  float32x4_t acc0 = vdupq_n_f32 (0.f);
+  float32x4_t acc1 = vdupq_n_f32 (0.f);
+  for (; i + 8 <= len; i += 8)
+    {
+      acc0 =
+        vmlaq_f32 (
+          acc0, vld1q_f32 (&a[i]), vld1q_f32 (&b[i]));
+      acc1 =
+        vmlaq_f32 (
+          acc1, vld1q_f32 (&a[i + 4]),
+          vld1q_f32 (&b[i + 4]));
+    }
+  acc0 = vaddq_f32 (acc0, acc1);
+  float tmp[4];
+  vst1q_f32 (tmp, acc0);
+  sum = (tmp[0] + tmp[1]) + (tmp[2] + tmp[3]);
+#endif
+  for (; i < len; i++)
+    sum += a[i] * b[i];
+
+  return sum;
+}
+
+size_t
+ad_pcm_get_sample_size (
+  ad_pcm_format format)
+{
+  switch (format)
+    {
+    case AD_PCM_U8:
+    case AD_PCM_S8:
+      return 1;
+    case AD_PCM_S16_LE:
+    case AD_PCM_S16_BE:
+      return 2;
+    case AD_PCM_S24_LE:
+    case AD_PCM_S24_BE:
+      return 3;
+    case AD_PCM_S32_LE:
+    case AD_PCM_S32_BE:
+    case AD_PCM_F32_LE:
+    case AD_PCM_F32_BE:
+      return 4;
+    case AD_PCM_F64_LE:
+    case AD_PCM_F64_BE:
+      return 8;
+    }
+
+  return 0;
+}
+
+static int
+is_float_format (
+  ad_pcm_format format)
+{
+  return
+    format == AD_PCM_F32_LE ||
+    format == AD_PCM_F32_BE ||
+    format == AD_PCM_F64_LE ||
+    format == AD_PCM_F64_BE;
+}
+
+/**
+ * Returns an integer sample scaled to the 32-bit
+ * range.
+ */
+static inline int32_t
+get_int_sample (
+  const uint8_t * p,
+  ad_pcm_format   format)
+{
+  uint32_t val = 0;
+  switch (format)
+    {
+    case AD_PCM_U8:
+      val = (uint32_t) (p[0] ^ 0x80) << 24;
+      break;
+    case AD_PCM_S8:
+      val = (uint32_t) p[0] << 24;
+      break;
+    case AD_PCM_S16_LE:
+      val =
+        (uint32_t) p[0] << 16 | (uint32_t) p[1] << 24;
+      break;
+    case AD_PCM_S16_BE:
+      val =
+        (uint32_t) p[1] << 16 | (uint32_t) p[0] << 24;
+      break;
+    case AD_PCM_S24_LE:
+      val =
+        (uint32_t) p[0] << 8 | (uint32_t) p[1] << 16 |
+        (uint32_t) p[2] << 24;
+      break;
+    case AD_PCM_S24_BE:
+      val =
+        (uint32_t) p[2] << 8 | (uint32_t) p[1] << 16 |
+        (uint32_t) p[0] << 24;
+      break;
+    case AD_PCM_S32_LE:
+      val =
+        (uint32_t) p[0] | (uint32_t) p[1] << 8 |
+        (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+      break;
+    case AD_PCM_S32_BE:
+      val =
+        (uint32_t) p[3] | (uint32_t) p[2] << 8 |
+        (uint32_t) p[1] << 16 | (uint32_t) p[0] << 24;
+      break;
+    default:
+      break;
+    }
+
+  return (int32_t) val;
+}
+
+static inline double
+get_float_sample (
+  const uint8_t * p,
+  ad_pcm_format   format)
+{
+  uint64_t val = 0;
+  int      big_endian =
+    format == AD_PCM_F32_BE || format == AD_PCM_F64_BE;
+  size_t   size = ad_pcm_get_sample_size (format);
+  for (size_t i = 0; i < size; i++)
+    {
+      size_t shift = big_endian ? size - 1 - i : i;
+      val |= (uint64_t) p[i] << (shift * 8);
+    }
+
+  if (size == 4)
+    {
+      uint32_t val32 = (uint32_t) val;
+      float    f;
+      memcpy (&f, &val32, sizeof (f));
+      return f;
+    }
+  double d;
+  memcpy (&d, &val, sizeof (d));
+  return d;
+}
+
+/**
+ * Scales a float sample to the 32-bit range, the
+ * same way as libsamplerate does.
+ */
+static inline int32_t
+float_to_int (
+  double val)
+{
+  val *= 2147483648.0;
+  if (val >= 2147483647.0)
+    return INT32_MAX;
+  if (val <= -2147483648.0)
+    return INT32_MIN;
+  return (int32_t) lrint (val);
+}
+
+void
+ad_pcm_to_float (
+  const uint8_t * src,
+  ad_pcm_format   format,
+  float *         dst,
+  size_t          len)
+{
+  size_t i = 0;
+  const float scale = 1.f / 2147483648.f;
+
+  switch (format)
+    {
+#if defined (HOST_LITTLE_ENDIAN)
+    case AD_PCM_F32_LE:
+      memcpy (dst, src, len * sizeof (float));
+      return;
+    case AD_PCM_S16_LE:
+#if defined (__SSE2__)
+      {
+        const __m128 s = _mm_set1_ps (1.f / 32768.f);
+        for (; i + 8 <= len; i += 8)
+          {
+            __m128i v =
+              _mm_loadu_si128 (
+                (const __m128i *) &src[i * 2]);
+            /* sign-extend by shifting the samples
+             * down from the top half */
+            __m128i lo =
+              _mm_srai_epi32 (
+                _mm_unpacklo_epi16 (v, v), 16);
+            __m128i hi =
+              _mm_srai_epi32 (
+                _mm_unpackhi_epi16 (v, v), 16);
+            _mm_storeu_ps (
+              &dst[i],
+              _mm_mul_ps (_mm_cvtepi32_ps (lo), s));
+            _mm_storeu_ps (
+              &dst[i + 4],
+              _mm_mul_ps (_mm_cvtepi32_ps (hi), s));
+          }
+      }
+#elif defined (__ARM_NEON)
+      for (; i + 8 <= len; i += 8)
+        {
+          int16x8_t v =
+            vreinterpretq_s16_u8 (vld1q_u8 (&src[i * 2]));
+          vst1q_f32 (
+            &dst[i],
+            vmulq_n_f32 (
+              vcvtq_f32_s32 (
+                vmovl_s16 (vget_low_s16 (v))),
+              1.f / 32768.f));
+          vst1q_f32 (
+            &dst[i + 4],
+            vmulq_n_f32 (
+              vcvtq_f32_s32 (
+                vmovl_s16 (vget_high_s16 (v))),
+              1.f / 32768.f));
+        }
+#endif
+      break;
+    case AD_PCM_S32_LE:
+#if defined (__SSE2__)
+      {
+        const __m128 s = _mm_set1_ps (scale);
+        for (; i + 4 <= len; i += 4)
+          _mm_storeu_ps (
+            &dst[i],
+            _mm_mul_ps (
+              _mm_cvtepi32_ps (
+                _mm_loadu_si128 (
+                  (const __m128i *) &src[i * 4])),
+              s));
+      }
+#elif defined (__ARM_NEON)
+      for (; i + 4 <= len; i += 4)
+        vst1q_f32 (
+          &dst[i],
+          vmulq_n_f32 (
+            vcvtq_f32_s32 (
+              vreinterpretq_s32_u8 (
+                vld1q_u8 (&src[i * 4]))),
+            scale));
+#endif
+      break;
+#endif
+    default:
+      break;
+    }
+
+  const size_t size = ad_pcm_get_sample_size (format);
+  if (is_float_format (format))
+    {
+      for (; i < len; i++)
+        dst[i] =
+          (float) get_float_sample (&src[i * size], format);
+    }
+  else
+    {
+      for (; i < len; i++)
+        dst[i] =
+          (float) get_int_sample (&src[i * size], format) *
+          scale;
+    }
+}
+
+void
+ad_pcm_to_short (
+  const uint8_t * src,
+  ad_pcm_format   format,
+  int16_t *       dst,
+  size_t          len)
+{
+#if defined (HOST_LITTLE_ENDIAN)
+  if (format == AD_PCM_S16_LE)
+    {
+      memcpy (dst, src, len * sizeof (int16_t));
+      return;
+    }
+#endif
+
+  const size_t size = ad_pcm_get_sample_size (format);
+  if (is_float_format (format))
+    {
+      for (size_t i = 0; i < len; i++)
+        dst[i] =
+          (int16_t) (
+            float_to_int (
+              get_float_sample (&src[i * size], format)) >>
+            16);
+    }
+  else
+    {
+      for (size_t i = 0; i < len; i++)
+        dst[i] =
+          (int16_t) (
+            get_int_sample (&src[i * size], format) >> 16);
+    }
+}
+
+void
+ad_pcm_to_int (
+  const uint8_t * src,
+  ad_pcm_format   format,
+  int32_t *       dst,
+  size_t          len)
+{
+#if defined (HOST_LITTLE_ENDIAN)
+  if (format == AD_PCM_S32_LE)
+    {
+      memcpy (dst, src, len * sizeof (int32_t));
+      return;
+    }
+#endif
+
+  const size_t size = ad_pcm_get_sample_size (format);
+  if (is_float_format (format))
+    {
+      for (size_t i = 0; i < len; i++)
+        dst[i] =
+          float_to_int (
+            get_float_sample (&src[i * size], format));
+    }
+  else
+    {
+      for (size_t i = 0; i < len; i++)
+        dst[i] = get_int_sample (&src[i * size], format);
+    }
+}
+
+void
+ad_pcm_to_double (
+  const uint8_t * src,
+  ad_pcm_format   format,
+  double *        dst,
+  size_t          len)
+{
+  const size_t size = ad_pcm_get_sample_size (format);
+  if (is_float_format (format))
+    {
+      for (size_t i = 0; i < len; i++)
+        dst[i] = get_float_sample (&src[i * size], format);
+    }
+  else
+    {
+      for (size_t i = 0; i < len; i++)
+        dst[i] =
+          get_int_sample (&src[i * size], format) /
+          2147483648.0;
+    }
+}
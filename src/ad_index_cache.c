@@ -0,0 +1,559 @@
+/*
+ * Copyright (C) 2021 Alexandros Theodotou <alex at zrythm dot org>
+ *
+ * This file is part of libaudec
+ *
+ * libaudec is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libaudec is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with libaudec.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Cache file format. All integers are unsigned
+ * LEB128 varints:
+ *
+ *   "AUDECIDX"          8-byte magic
+ *   version
+ *   path length, path   canonical path of the file
+ *   size
+ *   mtime seconds, mtime nanoseconds
+ *   content hash
+ *   total samples
+ *   number of entries
+ *   entries             sample and offset deltas
+ *                       from the previous entry
+ *   checksum            of everything before it
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "ad_index_cache.h"
+#include "ad_plugin.h"
+
+#define CACHE_MAGIC "AUDECIDX"
+#define CACHE_MAGIC_LEN 8
+#define CACHE_VERSION 1
+
+/** Bytes hashed at each end of the file. */
+#define HASH_CHUNK_SIZE 65536
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+static pthread_mutex_t dir_lock =
+  PTHREAD_MUTEX_INITIALIZER;
+static char * cache_dir = NULL;
+
+/** Numbers the temporary files of this process, so
+ * that threads saving the same index do not write
+ * to the same file. Guarded by dir_lock. */
+static unsigned long tmp_counter = 0;
+
+typedef struct cache_key
+{
+  char *   path;
+  uint64_t size;
+  uint64_t mtime_sec;
+  uint64_t mtime_nsec;
+  uint64_t content_hash;
+} cache_key;
+
+/** Growable output buffer. */
+typedef struct out_buf
+{
+  uint8_t * data;
+  size_t    len;
+  size_t    capacity;
+  int       failed;
+} out_buf;
+
+/** Bounded input cursor. */
+typedef struct in_buf
+{
+  const uint8_t * data;
+  size_t          len;
+  size_t          pos;
+  int             failed;
+} in_buf;
+
+static uint64_t
+fnv1a (
+  uint64_t        hash,
+  const uint8_t * data,
+  size_t          len)
+{
+  for (size_t i = 0; i < len; i++)
+    {
+      hash ^= data[i];
+      hash *= FNV_PRIME;
+    }
+  return hash;
+}
+
+/**
+ * Hashes the size and both ends of the file, which
+ * catches rewritten files whose size and mtime
+ * were preserved without reading all of it.
+ */
+static uint64_t
+hash_contents (
+  const uint8_t * data,
+  size_t          size)
+{
+  uint64_t size64 = size;
+  uint64_t hash =
+    fnv1a (
+      FNV_OFFSET, (const uint8_t *) &size64,
+      sizeof (size64));
+  size_t head = size < HASH_CHUNK_SIZE ? size : HASH_CHUNK_SIZE;
+  hash = fnv1a (hash, data, head);
+  if (size > head)
+    {
+      size_t tail_len = size - head;
+      if (tail_len > HASH_CHUNK_SIZE)
+        tail_len = HASH_CHUNK_SIZE;
+      hash = fnv1a (hash, data + size - tail_len, tail_len);
+    }
+  return hash;
+}
+
+static void
+put_byte (
+  out_buf * buf,
+  uint8_t   byte)
+{
+  if (buf->failed)
+    return;
+  if (buf->len == buf->capacity)
+    {
+      size_t capacity =
+        buf->capacity ? buf->capacity * 2 : 4096;
+      uint8_t * data = realloc (buf->data, capacity);
+      if (!data)
+        {
+          buf->failed = 1;
+          return;
+        }
+      buf->data = data;
+      buf->capacity = capacity;
+    }
+  buf->data[buf->len++] = byte;
+}
+
+static void
+put_varint (
+  out_buf * buf,
+  uint64_t  val)
+{
+  while (val >= 0x80)
+    {
+      put_byte (buf, (uint8_t) (val | 0x80));
+      val >>= 7;
+    }
+  put_byte (buf, (uint8_t) val);
+}
+
+static void
+put_bytes (
+  out_buf *    buf,
+  const void * data,
+  size_t       len)
+{
+  for (size_t i = 0; i < len; i++)
+    put_byte (buf, ((const uint8_t *) data)[i]);
+}
+
+static uint64_t
+get_varint (
+  in_buf * buf)
+{
+  uint64_t val = 0;
+  for (unsigned int shift = 0; shift < 64; shift += 7)
+    {
+      if (buf->pos >= buf->len)
+        break;
+      uint8_t byte = buf->data[buf->pos++];
+      val |= (uint64_t) (byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return val;
+    }
+  buf->failed = 1;
+  return 0;
+}
+
+static char *
+get_canonical_path (
+  const char * filename)
+{
+#ifdef _WIN32
+  return _fullpath (NULL, filename, 0);
+#else
+  return realpath (filename, NULL);
+#endif
+}
+
+static int
+make_key (
+  const char *    filename,
+  const uint8_t * data,
+  size_t          size,
+  cache_key *     key)
+{
+  struct stat st;
+  if (stat (filename, &st) != 0)
+    return -1;
+
+  key->path = get_canonical_path (filename);
+  if (!key->path)
+    return -1;
+
+  key->size = size;
+  key->mtime_sec = (uint64_t) st.st_mtime;
+#if defined (__APPLE__)
+  key->mtime_nsec = (uint64_t) st.st_mtimespec.tv_nsec;
+#elif defined (_WIN32)
+  key->mtime_nsec = 0;
+#else
+  key->mtime_nsec = (uint64_t) st.st_mtim.tv_nsec;
+#endif
+  key->content_hash = hash_contents (data, size);
+
+  return 0;
+}
+
+/**
+ * Returns the path of the cache file for the
+ * given key, named after a hash of the file's
+ * path, or NULL if the cache is disabled.
+ */
+static char *
+get_cache_file (
+  const cache_key * key)
+{
+  uint64_t hash =
+    fnv1a (
+      FNV_OFFSET, (const uint8_t *) key->path,
+      strlen (key->path));
+
+  char * path = NULL;
+  pthread_mutex_lock (&dir_lock);
+  if (cache_dir)
+    {
+      size_t len = strlen (cache_dir) + 32;
+      path = malloc (len);
+      if (path)
+        snprintf (
+          path, len, "%s/%016llx.idx", cache_dir,
+          (unsigned long long) hash);
+    }
+  pthread_mutex_unlock (&dir_lock);
+
+  return path;
+}
+
+int
+ad_index_cache_set_dir (
+  const char * dir)
+{
+  char * new_dir = NULL;
+  if (dir)
+    {
+#ifdef _WIN32
+      int ret = mkdir (dir);
+#else
+      int ret = mkdir (dir, 0755);
+#endif
+      if (ret != 0 && errno != EEXIST)
+        {
+          dbg (
+            AUDEC_LOG_LEVEL_ERROR,
+            "failed to create index cache directory "
+            "'%s'", dir);
+          return -1;
+        }
+      new_dir = strdup (dir);
+      if (!new_dir)
+        return -1;
+    }
+
+  pthread_mutex_lock (&dir_lock);
+  char * old_dir = cache_dir;
+  cache_dir = new_dir;
+  pthread_mutex_unlock (&dir_lock);
+
+  free (old_dir);
+
+  return 0;
+}
+
+int
+ad_index_cache_is_enabled (void)
+{
+  pthread_mutex_lock (&dir_lock);
+  int enabled = cache_dir != NULL;
+  pthread_mutex_unlock (&dir_lock);
+
+  return enabled;
+}
+
+static uint8_t *
+read_file (
+  const char * path,
+  size_t *     len)
+{
+  FILE * f = fopen (path, "rb");
+  if (!f)
+    return NULL;
+
+  uint8_t * data = NULL;
+  long file_len = -1;
+  if (fseek (f, 0, SEEK_END) == 0)
+    file_len = ftell (f);
+  if (file_len > 0 && fseek (f, 0, SEEK_SET) == 0)
+    {
+      data = malloc ((size_t) file_len);
+      if (data &&
+          fread (data, 1, (size_t) file_len, f) !=
+            (size_t) file_len)
+        {
+          free (data);
+          data = NULL;
+        }
+    }
+  fclose (f);
+
+  *len = (size_t) file_len;
+  return data;
+}
+
+static int
+parse (
+  in_buf *          buf,
+  const cache_key * key,
+  uint64_t *        total_samples,
+  ad_index_entry ** entries,
+  size_t *          num_entries)
+{
+  /* the checksum is the last varint, so find where
+   * it starts from the end */
+  if (buf->len < CACHE_MAGIC_LEN + 1 ||
+      memcmp (buf->data, CACHE_MAGIC, CACHE_MAGIC_LEN))
+    return -1;
+  size_t body_len = buf->len - 1;
+  while (body_len > CACHE_MAGIC_LEN &&
+         (buf->data[body_len - 1] & 0x80))
+    body_len--;
+  in_buf sum_buf = {
+    .data = buf->data + body_len,
+    .len = buf->len - body_len };
+  uint64_t checksum = get_varint (&sum_buf);
+  if (sum_buf.failed ||
+      checksum != fnv1a (FNV_OFFSET, buf->data, body_len))
+    return -1;
+  buf->len = body_len;
+  buf->pos = CACHE_MAGIC_LEN;
+
+  if (get_varint (buf) != CACHE_VERSION)
+    return -1;
+  uint64_t path_len = get_varint (buf);
+  if (buf->failed || path_len > buf->len - buf->pos ||
+      path_len != strlen (key->path) ||
+      memcmp (
+        buf->data + buf->pos, key->path,
+        (size_t) path_len))
+    return -1;
+  buf->pos += (size_t) path_len;
+
+  if (get_varint (buf) != key->size ||
+      get_varint (buf) != key->mtime_sec ||
+      get_varint (buf) != key->mtime_nsec ||
+      get_varint (buf) != key->content_hash)
+    return -1;
+
+  *total_samples = get_varint (buf);
+  uint64_t count = get_varint (buf);
+  /* each entry takes at least 2 bytes */
+  if (buf->failed || count == 0 ||
+      count > (buf->len - buf->pos) / 2)
+    return -1;
+
+  ad_index_entry * res =
+    malloc ((size_t) count * sizeof (ad_index_entry));
+  if (!res)
+    return -1;
+  uint64_t sample = 0, offset = 0;
+  for (size_t i = 0; i < count; i++)
+    {
+      sample += get_varint (buf);
+      offset += get_varint (buf);
+      res[i].sample = sample;
+      res[i].offset = offset;
+    }
+  if (buf->failed || buf->pos != buf->len ||
+      offset >= key->size)
+    {
+      free (res);
+      return -1;
+    }
+
+  *entries = res;
+  *num_entries = (size_t) count;
+  return 0;
+}
+
+int
+ad_index_cache_load (
+  const char *      filename,
+  const uint8_t *   data,
+  size_t            size,
+  uint64_t *        total_samples,
+  ad_index_entry ** entries,
+  size_t *          num_entries)
+{
+  cache_key key;
+  if (make_key (filename, data, size, &key) != 0)
+    return -1;
+
+  int ret = -1;
+  char * cache_file = get_cache_file (&key);
+  if (cache_file)
+    {
+      in_buf buf = { 0 };
+      uint8_t * cache_data =
+        read_file (cache_file, &buf.len);
+      if (cache_data)
+        {
+          buf.data = cache_data;
+          ret =
+            parse (
+              &buf, &key, total_samples, entries,
+              num_entries);
+          free (cache_data);
+        }
+      if (ret == 0)
+        {
+          dbg (
+            AUDEC_LOG_LEVEL_DEBUG,
+            "loaded index of '%s' from '%s'",
+            filename, cache_file);
+        }
+    }
+
+  free (cache_file);
+  free (key.path);
+
+  return ret;
+}
+
+int
+ad_index_cache_save (
+  const char *           filename,
+  const uint8_t *        data,
+  size_t                 size,
+  uint64_t               total_samples,
+  const ad_index_entry * entries,
+  size_t                 num_entries)
+{
+  if (!num_entries)
+    return -1;
+
+  cache_key key;
+  if (make_key (filename, data, size, &key) != 0)
+    return -1;
+
+  char * cache_file = get_cache_file (&key);
+  if (!cache_file)
+    {
+      free (key.path);
+      return -1;
+    }
+
+  out_buf buf = { 0 };
+  put_bytes (&buf, CACHE_MAGIC, CACHE_MAGIC_LEN);
+  put_varint (&buf, CACHE_VERSION);
+  size_t path_len = strlen (key.path);
+  put_varint (&buf, path_len);
+  put_bytes (&buf, key.path, path_len);
+  put_varint (&buf, key.size);
+  put_varint (&buf, key.mtime_sec);
+  put_varint (&buf, key.mtime_nsec);
+  put_varint (&buf, key.content_hash);
+  put_varint (&buf, total_samples);
+  put_varint (&buf, num_entries);
+  uint64_t sample = 0, offset = 0;
+  for (size_t i = 0; i < num_entries; i++)
+    {
+      put_varint (&buf, entries[i].sample - sample);
+      put_varint (&buf, entries[i].offset - offset);
+      sample = entries[i].sample;
+      offset = entries[i].offset;
+    }
+  if (!buf.failed)
+    put_varint (&buf, fnv1a (FNV_OFFSET, buf.data, buf.len));
+
+  /* write to a temporary file and rename it, so
+   * that concurrent readers never see a partial
+   * index */
+  int ret = -1;
+  size_t tmp_len = strlen (cache_file) + 48;
+  char * tmp_file = malloc (tmp_len);
+  if (!buf.failed && tmp_file)
+    {
+      pthread_mutex_lock (&dir_lock);
+      unsigned long tmp_id = tmp_counter++;
+      pthread_mutex_unlock (&dir_lock);
+      snprintf (
+        tmp_file, tmp_len, "%s.%ld.%lu.tmp",
+        cache_file, (long) getpid (), tmp_id);
+      FILE * f = fopen (tmp_file, "wb");
+      if (f)
+        {
+          int written =
+            fwrite (buf.data, 1, buf.len, f) == buf.len;
+          if (fclose (f) == 0 && written)
+            {
+#ifdef _WIN32
+              remove (cache_file);
+#endif
+              if (rename (tmp_file, cache_file) == 0)
+                ret = 0;
+            }
+          if (ret != 0)
+            remove (tmp_file);
+        }
+    }
+
+  if (ret != 0)
+    {
+      dbg (
+        AUDEC_LOG_LEVEL_ERROR,
+        "failed to save index of '%s' to '%s'",
+        filename, cache_file);
+    }
+
+  free (tmp_file);
+  free (buf.data);
+  free (cache_file);
+  free (key.path);
+
+  return ret;
+}
@@ -37,23 +37,71 @@
 
 #include "config.h"
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <math.h>
 
+#include "ad_index_cache.h"
 #include "ad_plugin.h"
+#include "ad_seek_index.h"
+#include "ad_thread_pool.h"
 
 #define MINIMP3_FLOAT_OUTPUT
 #define MINIMP3_IMPLEMENTATION
 #include "minimp3_ex.h"
 
+/** Minimum number of frames each thread decodes
+ * in parallel reads, so that the warm-up before
+ * each range stays negligible. */
+#define MIN_PARALLEL_FRAMES (1152 * 64)
+
+/** Number of index entries expanded before the
+ * target frame when seeking, which covers the
+ * frames minimp3 decodes before it to fill the bit
+ * reservoir. */
+#define SEEK_WINDOW_BEFORE 64
+#define SEEK_WINDOW_SIZE (SEEK_WINDOW_BEFORE + 2)
+
 /* internal abstraction */
 
 typedef struct {
   mp3dec_ex_t        dec_ex;
+
+  /** Number of frames in the file, estimated from
+   * the bitrate when opened lazily without a VBR
+   * header until the seek index is built. */
+  uint64_t           frames;
+
+  /** Compact copy of minimp3's seek index, which is
+   * freed once built. */
+  ad_seek_index *    index;
+
+  /** Path the file was opened with, for saving its
+   * index to the cache, or NULL if it was opened
+   * from memory or callbacks. */
+  char *             filename;
+
+  /** Contents of a file opened from memory. */
+  const uint8_t *    buf;
+
+  /** Size of the file in bytes, or 0 if unknown. */
+  uint64_t           size;
+
+  /** Callbacks of a file opened with them, which
+   * mp3_io forwards to. */
+  AudecIO            io;
+  void *             io_data;
+  mp3dec_io_t        mp3_io;
+
+  /** Descriptor of a file opened from one, and the
+   * offset the file starts at. */
+  int                fd;
+  int64_t            fd_start;
 } minimp3_audio_decoder;
 
 static void
@@ -96,7 +144,7 @@ ad_info_minimp3 (
   if (nfo)
     {
       nfo->channels = priv->dec_ex.info.channels;
-      nfo->frames = priv->dec_ex.samples / nfo->channels;
+      nfo->frames = (int64_t) priv->frames;
       nfo->sample_rate = priv->dec_ex.info.hz;
       nfo->length =
         nfo->frames ?
@@ -110,34 +158,546 @@ ad_info_minimp3 (
   return 0;
 }
 
+/**
+ * Estimates the number of frames of a file without
+ * a VBR header from its size and the bitrate of the
+ * first frame, which is exact for CBR files.
+ */
+static uint64_t
+estimate_frames (
+  minimp3_audio_decoder * priv)
+{
+  mp3dec_ex_t * dec = &priv->dec_ex;
+  if (dec->info.bitrate_kbps <= 0 ||
+      priv->size <= dec->start_offset)
+    return 0;
+
+  uint64_t bytes =
+    priv->size - dec->start_offset;
+  return
+    (bytes * 8 * (uint64_t) dec->info.hz) /
+    ((uint64_t) dec->info.bitrate_kbps * 1000);
+}
+
+static size_t
+get_frame_size (
+  const uint8_t * frame,
+  size_t          len,
+  void *          user_data)
+{
+  minimp3_audio_decoder * priv =
+    (minimp3_audio_decoder *) user_data;
+  if (len < HDR_SIZE || !hdr_valid (frame))
+    return 0;
+
+  size_t size =
+    (size_t)
+    (hdr_frame_bytes (
+       frame, priv->dec_ex.free_format_bytes) +
+     hdr_padding (frame));
+  return size <= len ? size : 0;
+}
+
+/**
+ * Counts the frames from the seek index, once it
+ * has been built.
+ */
+static uint64_t
+get_frames_from_index (
+  minimp3_audio_decoder * priv)
+{
+  mp3dec_ex_t * dec = &priv->dec_ex;
+  if (!priv->index)
+    return 0;
+
+  ad_index_entry last;
+  if (ad_seek_index_get_entries (
+        priv->index,
+        ad_seek_index_get_num_entries (priv->index) - 1,
+        1, &last) != 0)
+    return 0;
+
+  /* read the last frame's header, and go back to
+   * where the decoder's stream was */
+  uint8_t hdr[HDR_SIZE];
+  if (dec->io)
+    {
+      if (dec->io->seek (last.offset, dec->io->seek_data) ||
+          dec->io->read (hdr, HDR_SIZE, dec->io->read_data) !=
+            HDR_SIZE ||
+          dec->io->seek (dec->offset, dec->io->seek_data))
+        return 0;
+    }
+  else
+    {
+      if (!dec->file.buffer ||
+          last.offset + HDR_SIZE > dec->file.size)
+        return 0;
+      memcpy (hdr, dec->file.buffer + last.offset, HDR_SIZE);
+    }
+
+  uint64_t samples =
+    last.sample +
+    (uint64_t) hdr_frame_samples (hdr) *
+      (uint64_t) dec->info.channels;
+  return samples / (uint64_t) dec->info.channels;
+}
+
+/**
+ * Keeps a compact index of the given frames
+ * instead of minimp3's.
+ */
+static int
+install_index (
+  minimp3_audio_decoder * priv,
+  const ad_index_entry *  entries,
+  size_t                  num_entries)
+{
+  mp3dec_ex_t * dec = &priv->dec_ex;
+  ad_seek_index * index =
+    ad_seek_index_new (
+      entries, num_entries,
+      dec->io ? NULL : dec->file.buffer,
+      dec->file.size, get_frame_size, priv);
+  if (!index)
+    return -1;
+
+  ad_seek_index_free (priv->index);
+  priv->index = index;
+  free (dec->index.frames);
+  memset (&dec->index, 0, sizeof (dec->index));
+  dec->indexes_built = 1;
+
+  dbg (
+    AUDEC_LOG_LEVEL_DEBUG,
+    "indexed %zu frames in %zu bytes", num_entries,
+    ad_seek_index_get_memory_size (index));
+
+  return 0;
+}
+
+/**
+ * Replaces the index minimp3 built by a compact
+ * one. minimp3's index is kept if that fails.
+ */
+static void
+compact_index (
+  minimp3_audio_decoder * priv)
+{
+  mp3dec_index_t * index = &priv->dec_ex.index;
+  if (!index->num_frames)
+    return;
+
+  ad_index_entry * entries =
+    malloc (index->num_frames * sizeof (ad_index_entry));
+  if (!entries)
+    return;
+  for (size_t i = 0; i < index->num_frames; i++)
+    {
+      entries[i].sample = index->frames[i].sample;
+      entries[i].offset = index->frames[i].offset;
+    }
+  install_index (priv, entries, index->num_frames);
+  free (entries);
+}
+
+/**
+ * Seeks \p dec, which is the handle's decoder or a
+ * copy of it, to the given interleaved sample.
+ *
+ * minimp3 only needs the index entries around the
+ * target frame, so those are expanded from the
+ * compact index for the duration of the seek.
+ */
+static int
+seek_decoder (
+  minimp3_audio_decoder * priv,
+  mp3dec_ex_t *           dec,
+  uint64_t                position)
+{
+  if (!priv->index)
+    return mp3dec_ex_seek (dec, position);
+
+  size_t num_entries =
+    ad_seek_index_get_num_entries (priv->index);
+  size_t target =
+    ad_seek_index_find (
+      priv->index,
+      position + (uint64_t) dec->start_delay);
+  size_t first =
+    target > SEEK_WINDOW_BEFORE ?
+    target - SEEK_WINDOW_BEFORE : 0;
+  size_t count = target - first + 2;
+  if (count > num_entries - first)
+    count = num_entries - first;
+
+  ad_index_entry entries[SEEK_WINDOW_SIZE];
+  mp3dec_frame_t frames[SEEK_WINDOW_SIZE];
+  if (ad_seek_index_get_entries (
+        priv->index, first, count, entries) != 0)
+    return MP3D_E_PARAM;
+  for (size_t i = 0; i < count; i++)
+    {
+      frames[i].sample = entries[i].sample;
+      frames[i].offset = entries[i].offset;
+    }
+
+  dec->index.frames = frames;
+  dec->index.num_frames = count;
+  dec->index.capacity = count;
+  int ret = mp3dec_ex_seek (dec, position);
+  memset (&dec->index, 0, sizeof (dec->index));
+
+  return ret;
+}
+
+/**
+ * Installs the cached index of the file, if there
+ * is a valid one.
+ *
+ * The decoder must have been opened with
+ * MP3D_DO_NOT_SCAN.
+ *
+ * @return 0 if the index was loaded, -1 otherwise.
+ */
+static int
+load_cached_index (
+  minimp3_audio_decoder * priv)
+{
+  mp3dec_ex_t * dec = &priv->dec_ex;
+  uint64_t total_samples;
+  ad_index_entry * entries;
+  size_t num_entries;
+  if (ad_index_cache_load (
+        priv->filename, dec->file.buffer,
+        dec->file.size, &total_samples, &entries,
+        &num_entries) != 0)
+    return -1;
+
+  int ret = install_index (priv, entries, num_entries);
+  free (entries);
+  if (ret != 0)
+    return -1;
+
+  if (!dec->vbr_tag_found)
+    dec->samples = total_samples;
+
+  return 0;
+}
+
+/**
+ * Saves the index of the file to the cache, if
+ * enabled.
+ */
+static void
+save_index (
+  minimp3_audio_decoder * priv)
+{
+  if (!priv->index || !priv->filename ||
+      !ad_index_cache_is_enabled ())
+    return;
+
+  mp3dec_ex_t * dec = &priv->dec_ex;
+  size_t num_entries =
+    ad_seek_index_get_num_entries (priv->index);
+  ad_index_entry * entries =
+    malloc (num_entries * sizeof (ad_index_entry));
+  if (!entries)
+    return;
+
+  if (ad_seek_index_get_entries (
+        priv->index, 0, num_entries, entries) == 0)
+    {
+      ad_index_cache_save (
+        priv->filename, dec->file.buffer,
+        dec->file.size,
+        priv->frames * (uint64_t) dec->info.channels,
+        entries, num_entries);
+    }
+  free (entries);
+}
+
+static size_t
+io_read (
+  void * buf,
+  size_t size,
+  void * user_data)
+{
+  minimp3_audio_decoder * priv =
+    (minimp3_audio_decoder *) user_data;
+  return priv->io.read (buf, size, priv->io_data);
+}
+
+static int
+io_seek (
+  uint64_t position,
+  void *   user_data)
+{
+  minimp3_audio_decoder * priv =
+    (minimp3_audio_decoder *) user_data;
+  return priv->io.seek (position, priv->io_data);
+}
+
+/**
+ * Opens the decoder on the handle's file, buffer
+ * or callbacks.
+ */
+static int
+open_decoder (
+  minimp3_audio_decoder * priv,
+  int                     mp3_flags)
+{
+  mp3dec_ex_t * dec = &priv->dec_ex;
+  int res;
+  if (priv->mp3_io.read)
+    {
+      res = mp3dec_ex_open_cb (dec, &priv->mp3_io, mp3_flags);
+      if (res)
+        mp3dec_ex_close (dec);
+    }
+  else if (priv->buf)
+    res =
+      mp3dec_ex_open_buf (
+        dec, priv->buf, (size_t) priv->size, mp3_flags);
+  else
+    {
+      res = mp3dec_ex_open (dec, priv->filename, mp3_flags);
+      if (!res)
+        priv->size = dec->file.size;
+    }
+
+  return res;
+}
+
+static void
+free_decoder (
+  minimp3_audio_decoder * priv)
+{
+  free (priv->filename);
+  free (priv);
+}
+
+/**
+ * Opens the file set up in \p priv, taking
+ * ownership of it.
+ */
 static void *
-ad_open_minimp3 (
-  const char * filename,
-  AudecInfo *  nfo)
+open_with_flags (
+  minimp3_audio_decoder * priv,
+  const char *            name,
+  AudecInfo *             nfo,
+  unsigned int            flags)
 {
-  minimp3_audio_decoder *priv =
-    (minimp3_audio_decoder*)
-    calloc (1, sizeof(minimp3_audio_decoder));
+  /* without scanning, only the first frames are
+   * read and the seek index is built by minimp3 on
+   * the first seek, or loaded from the cache */
+  int lazy = flags & AUDEC_OPEN_LAZY_INDEX;
+  int use_cache =
+    priv->filename && ad_index_cache_is_enabled ();
   int res =
-    mp3dec_ex_open (
-      &priv->dec_ex, filename, MP3D_SEEK_TO_SAMPLE);
+    open_decoder (
+      priv,
+      MP3D_SEEK_TO_SAMPLE |
+        (lazy || use_cache ? MP3D_DO_NOT_SCAN : 0));
+  int cached = 0;
+  if (!res && use_cache)
+    {
+      cached = load_cached_index (priv) == 0;
+      if (!cached && !lazy)
+        {
+          mp3dec_ex_close (&priv->dec_ex);
+          res = open_decoder (priv, MP3D_SEEK_TO_SAMPLE);
+        }
+    }
+  if (!res && priv->dec_ex.info.channels <= 0)
+    {
+      /* no frames found */
+      mp3dec_ex_close (&priv->dec_ex);
+      res = MP3D_E_DECODE;
+    }
   if (res)
     {
-      dbg (
-        AUDEC_LOG_LEVEL_ERROR,
-        "unable to open file '%s'.", filename);
+      /* files not opened by name are probed with
+       * each backend in turn, so failing is
+       * expected */
       char err_str[600];
       err_to_string (res, err_str);
-      puts (err_str);
       dbg (
-        AUDEC_LOG_LEVEL_ERROR, "error=%i", res);
-      free (priv);
+        priv->filename ?
+          AUDEC_LOG_LEVEL_ERROR : AUDEC_LOG_LEVEL_DEBUG,
+        "unable to open file '%s': %s (error=%i)",
+        name, err_str, res);
+      free_decoder (priv);
       return NULL;
     }
+
+  if (!cached && priv->dec_ex.indexes_built)
+    compact_index (priv);
+
+  if (!lazy || cached || priv->dec_ex.vbr_tag_found)
+    priv->frames =
+      priv->dec_ex.samples /
+      (uint64_t) priv->dec_ex.info.channels;
+  else
+    priv->frames = estimate_frames (priv);
+
+  if (use_cache && !cached)
+    save_index (priv);
+
   ad_info_minimp3 (priv, nfo);
   return (void*) priv;
 }
 
+static void *
+ad_open_minimp3_with_flags (
+  const char * filename,
+  AudecInfo *  nfo,
+  unsigned int flags)
+{
+  minimp3_audio_decoder *priv =
+    (minimp3_audio_decoder*)
+    calloc (1, sizeof(minimp3_audio_decoder));
+  if (!priv)
+    return NULL;
+  priv->filename = strdup (filename);
+  if (!priv->filename)
+    {
+      free (priv);
+      return NULL;
+    }
+
+  return open_with_flags (priv, filename, nfo, flags);
+}
+
+static void *
+ad_open_minimp3 (
+  const char * filename,
+  AudecInfo *  nfo)
+{
+  return ad_open_minimp3_with_flags (filename, nfo, 0);
+}
+
+static void *
+ad_open_memory_minimp3 (
+  const void * data,
+  size_t       size,
+  AudecInfo *  nfo,
+  unsigned int flags)
+{
+  minimp3_audio_decoder *priv =
+    (minimp3_audio_decoder*)
+    calloc (1, sizeof(minimp3_audio_decoder));
+  if (!priv)
+    return NULL;
+  priv->buf = (const uint8_t *) data;
+  priv->size = size;
+
+  return open_with_flags (priv, "<memory>", nfo, flags);
+}
+
+static size_t
+fd_read (
+  void * buf,
+  size_t size,
+  void * user_data)
+{
+  minimp3_audio_decoder * priv =
+    (minimp3_audio_decoder *) user_data;
+  size_t total = 0;
+  while (total < size)
+    {
+      ssize_t res =
+        read (priv->fd, (uint8_t *) buf + total, size - total);
+      if (res < 0 && errno == EINTR)
+        continue;
+      if (res <= 0)
+        break;
+      total += (size_t) res;
+    }
+  return total;
+}
+
+static int
+fd_seek (
+  uint64_t position,
+  void *   user_data)
+{
+  minimp3_audio_decoder * priv =
+    (minimp3_audio_decoder *) user_data;
+  off_t offset = (off_t) (priv->fd_start + (int64_t) position);
+  return lseek (priv->fd, offset, SEEK_SET) == offset ? 0 : -1;
+}
+
+static int64_t
+fd_get_size (
+  void * user_data)
+{
+  minimp3_audio_decoder * priv =
+    (minimp3_audio_decoder *) user_data;
+  struct stat st;
+  if (fstat (priv->fd, &st) != 0 || !S_ISREG (st.st_mode))
+    return -1;
+  return (int64_t) st.st_size - priv->fd_start;
+}
+
+static void *
+ad_open_io_minimp3 (
+  const AudecIO * io,
+  void *          user_data,
+  AudecInfo *     nfo,
+  unsigned int    flags)
+{
+  minimp3_audio_decoder *priv =
+    (minimp3_audio_decoder*)
+    calloc (1, sizeof(minimp3_audio_decoder));
+  if (!priv)
+    return NULL;
+  priv->io = *io;
+  priv->io_data = user_data;
+  priv->mp3_io.read = io_read;
+  priv->mp3_io.read_data = priv;
+  priv->mp3_io.seek = io_seek;
+  priv->mp3_io.seek_data = priv;
+  if (io->get_size)
+    {
+      int64_t size = io->get_size (user_data);
+      priv->size = size > 0 ? (uint64_t) size : 0;
+    }
+
+  return open_with_flags (priv, "<io>", nfo, flags);
+}
+
+static void *
+ad_open_fd_minimp3 (
+  int          fd,
+  AudecInfo *  nfo,
+  unsigned int flags)
+{
+  off_t start = lseek (fd, 0, SEEK_CUR);
+  if (start < 0)
+    return NULL;
+
+  minimp3_audio_decoder *priv =
+    (minimp3_audio_decoder*)
+    calloc (1, sizeof(minimp3_audio_decoder));
+  if (!priv)
+    return NULL;
+  priv->fd = fd;
+  priv->fd_start = (int64_t) start;
+  priv->io.read = fd_read;
+  priv->io.seek = fd_seek;
+  priv->io.get_size = fd_get_size;
+  priv->io_data = priv;
+  priv->mp3_io.read = io_read;
+  priv->mp3_io.read_data = priv;
+  priv->mp3_io.seek = io_seek;
+  priv->mp3_io.seek_data = priv;
+  int64_t size = fd_get_size (priv);
+  priv->size = size > 0 ? (uint64_t) size : 0;
+
+  return open_with_flags (priv, "<fd>", nfo, flags);
+}
+
 static int
 ad_close_minimp3 (
   void *sf)
@@ -150,7 +710,8 @@ ad_close_minimp3 (
       return -1;
     }
   mp3dec_ex_close (&priv->dec_ex);
-  free (priv);
+  ad_seek_index_free (priv->index);
+  free_decoder (priv);
   return 0;
 }
 
@@ -160,7 +721,33 @@ ad_seek_minimp3 (
 {
   minimp3_audio_decoder *priv = (minimp3_audio_decoder*) sf;
   if (!priv) return -1;
-  return mp3dec_ex_seek (&priv->dec_ex, pos);
+
+  /* minimp3 seeks to interleaved samples */
+  mp3dec_ex_t * dec = &priv->dec_ex;
+  int indexes_built = dec->indexes_built;
+  int ret =
+    seek_decoder (
+      priv, dec,
+      (uint64_t) pos * (uint64_t) dec->info.channels);
+  if (ret)
+    return -1;
+
+  /* the first seek of a lazily opened file without
+   * a VBR header builds the index, which gives the
+   * exact length */
+  if (!indexes_built && dec->indexes_built)
+    {
+      compact_index (priv);
+      if (!dec->vbr_tag_found)
+        {
+          uint64_t frames = get_frames_from_index (priv);
+          if (frames)
+            priv->frames = frames;
+        }
+      save_index (priv);
+    }
+
+  return pos;
 }
 
 static ssize_t
@@ -172,6 +759,143 @@ ad_read_minimp3 (
   return mp3dec_ex_read (&priv->dec_ex, d, len);
 }
 
+/**
+ * A range of interleaved samples decoded by one
+ * thread.
+ */
+typedef struct parallel_range
+{
+  uint64_t start;
+  uint64_t len;
+  uint64_t decoded;
+} parallel_range;
+
+typedef struct parallel_read_data
+{
+  minimp3_audio_decoder * priv;
+  const mp3dec_ex_t * dec;
+  float *             dst;
+  parallel_range *    ranges;
+} parallel_read_data;
+
+static void
+parallel_read_task (
+  void * data,
+  size_t task)
+{
+  parallel_read_data * pd =
+    (parallel_read_data *) data;
+  parallel_range * range = &pd->ranges[task];
+
+  /* each thread decodes through its own copy of the
+   * decoder, which shares the read-only file
+   * buffer and index. Seeking decodes a few frames
+   * before the range to fill the bit reservoir and
+   * the overlap state, as for any seek */
+  mp3dec_ex_t * dec = malloc (sizeof (mp3dec_ex_t));
+  if (!dec)
+    return;
+  *dec = *pd->dec;
+  if (seek_decoder (pd->priv, dec, range->start) == 0)
+    {
+      range->decoded =
+        mp3dec_ex_read (
+          dec, &pd->dst[range->start],
+          (size_t) range->len);
+    }
+  free (dec);
+}
+
+static ssize_t
+ad_read_parallel_minimp3 (
+  void *       sf,
+  float *      dst,
+  size_t       max_frames,
+  unsigned int num_threads)
+{
+  minimp3_audio_decoder *priv = (minimp3_audio_decoder*) sf;
+  if (!priv)
+    return -1;
+
+  mp3dec_ex_t * dec = &priv->dec_ex;
+  uint64_t channels = (uint64_t) dec->info.channels;
+  if (dec->io || channels == 0)
+    return -1;
+
+  /* the ranges are found through the index, so
+   * build it if the file was opened lazily */
+  if (!dec->indexes_built &&
+      ad_seek_minimp3 (priv, 1) < 0)
+    return -1;
+  if (!priv->index && !dec->index.num_frames)
+    return -1;
+
+  if (!dst)
+    return (ssize_t) priv->frames;
+
+  uint64_t total_frames = priv->frames;
+  if (total_frames > max_frames)
+    total_frames = max_frames;
+  if (num_threads < 1)
+    num_threads = 1;
+  size_t num_ranges =
+    (size_t) (total_frames / MIN_PARALLEL_FRAMES);
+  if (num_ranges > num_threads)
+    num_ranges = num_threads;
+  if (num_ranges < 2)
+    return -1;
+
+  parallel_range * ranges =
+    calloc (num_ranges, sizeof (parallel_range));
+  ad_thread_pool * pool =
+    ad_thread_pool_new ((unsigned int) num_ranges);
+  ssize_t ret = -1;
+  if (ranges && pool)
+    {
+      for (size_t i = 0; i < num_ranges; i++)
+        {
+          uint64_t start =
+            total_frames * i / num_ranges;
+          uint64_t end =
+            total_frames * (i + 1) / num_ranges;
+          ranges[i].start = start * channels;
+          ranges[i].len = (end - start) * channels;
+        }
+
+      parallel_read_data pd = {
+        .priv = priv,
+        .dec = dec,
+        .dst = dst,
+        .ranges = ranges,
+      };
+      ad_thread_pool_run (
+        pool, parallel_read_task, &pd, num_ranges);
+
+      /* only the last range may stop short, if the
+       * length came from an estimate */
+      ret = 0;
+      for (size_t i = 0; i < num_ranges; i++)
+        {
+          if (i < num_ranges - 1 &&
+              ranges[i].decoded != ranges[i].len)
+            {
+              dbg (
+                AUDEC_LOG_LEVEL_ERROR,
+                "failed to decode range %zu", i);
+              ret = -1;
+              break;
+            }
+          ret +=
+            (ssize_t) (ranges[i].decoded / channels);
+        }
+    }
+
+  ad_thread_pool_free (pool);
+  free (ranges);
+
+  return ret;
+}
+
 static int ad_eval_minimp3(const char *f)
 {
   char *ext = strrchr(f, '.');
@@ -184,10 +908,15 @@ static int ad_eval_minimp3(const char *f)
 static const ad_plugin ad_minimp3 = {
   .eval = &ad_eval_minimp3,
   .open = &ad_open_minimp3,
+  .open_with_flags = &ad_open_minimp3_with_flags,
+  .open_memory = &ad_open_memory_minimp3,
+  .open_io = &ad_open_io_minimp3,
+  .open_fd = &ad_open_fd_minimp3,
   .close = &ad_close_minimp3,
   .info = &ad_info_minimp3,
   .seek = &ad_seek_minimp3,
-  .read = &ad_read_minimp3
+  .read = &ad_read_minimp3,
+  .read_parallel = &ad_read_parallel_minimp3,
 };
 
 /* dlopen handler */
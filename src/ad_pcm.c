@@ -0,0 +1,840 @@
+/*
+ * Copyright (C) 2021 Alexandros Theodotou <alex at zrythm dot org>
+ *
+ * This file is part of libaudec
+ *
+ * libaudec is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libaudec is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with libaudec.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Backend for uncompressed PCM in WAV, RF64, W64
+ * and AIFF files.
+ *
+ * The headers are parsed here and the file is
+ * mapped into memory, so that samples are
+ * converted straight from the data chunk into the
+ * caller's buffer. Other encodings are left to
+ * libsndfile.
+ */
+
+#include "config.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include "ad_dsp.h"
+#include "ad_plugin.h"
+
+/** Most channels accepted, as in libsndfile. */
+#define MAX_CHANNELS 1024
+
+typedef struct pcm_decoder
+{
+  /** Mapping of the file, if it was mapped. */
+  void *          map;
+  size_t          map_size;
+
+  /** First frame of the data chunk. */
+  const uint8_t * data;
+
+  ad_pcm_format   format;
+  int             channels;
+  int             sample_rate;
+  int             bit_depth;
+  float           bpm;
+
+  /** Size of a frame in bytes. */
+  size_t          frame_size;
+
+  int64_t         frames;
+
+  /** Read position in frames. */
+  int64_t         pos;
+} pcm_decoder;
+
+/** Last 12 bytes of the GUIDs of the W64 "wave",
+ * "fmt " and "data" chunks, after their FourCC. */
+static const uint8_t w64_guid_tail[12] = {
+  0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1,
+  0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a,
+};
+
+static const uint8_t w64_riff_guid[16] = {
+  'r', 'i', 'f', 'f', 0x2e, 0x91, 0xcf, 0x11,
+  0xa5, 0xd6, 0x28, 0xdb, 0x04, 0xc1, 0x00, 0x00,
+};
+
+/** Last 12 bytes of the WAVE_FORMAT_EXTENSIBLE
+ * sub-format GUIDs, after the format tag. */
+static const uint8_t ksdataformat_tail[12] = {
+  0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+  0x80, 0x00, 0x00, 0xaa, 0x00, 0x38,
+};
+
+static uint16_t
+get_le16 (
+  const uint8_t * p)
+{
+  return (uint16_t) (p[0] | p[1] << 8);
+}
+
+static uint32_t
+get_le32 (
+  const uint8_t * p)
+{
+  return
+    (uint32_t) p[0] | (uint32_t) p[1] << 8 |
+    (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static uint64_t
+get_le64 (
+  const uint8_t * p)
+{
+  return
+    (uint64_t) get_le32 (p) |
+    (uint64_t) get_le32 (p + 4) << 32;
+}
+
+static uint16_t
+get_be16 (
+  const uint8_t * p)
+{
+  return (uint16_t) (p[0] << 8 | p[1]);
+}
+
+static uint32_t
+get_be32 (
+  const uint8_t * p)
+{
+  return
+    (uint32_t) p[0] << 24 | (uint32_t) p[1] << 16 |
+    (uint32_t) p[2] << 8 | (uint32_t) p[3];
+}
+
+/**
+ * Returns the AIFF sample rate, an 80-bit IEEE
+ * extended float, or 0 if it is not positive or
+ * too large.
+ */
+static int
+get_extended_rate (
+  const uint8_t * p)
+{
+  /* rates from 1 to 2^30 */
+  int exponent = ((p[0] & 0x7f) << 8 | p[1]) - 16383;
+  if ((p[0] & 0x80) || exponent < 0 || exponent >= 30)
+    return 0;
+
+  uint64_t mantissa =
+    (uint64_t) get_be32 (p + 2) << 32 |
+    get_be32 (p + 6);
+  return
+    (int) lrint (
+      ldexp ((double) mantissa, exponent - 63));
+}
+
+/**
+ * Parses a WAV or W64 "fmt " chunk.
+ *
+ * @return 0 if the encoding is supported, -1
+ *   otherwise.
+ */
+static int
+parse_fmt (
+  pcm_decoder *   self,
+  const uint8_t * chunk,
+  size_t          len)
+{
+  if (len < 16)
+    return -1;
+
+  unsigned int tag = get_le16 (chunk);
+  unsigned int block_align = get_le16 (chunk + 12);
+  unsigned int bits = get_le16 (chunk + 14);
+  self->channels = get_le16 (chunk + 2);
+  self->sample_rate = (int) get_le32 (chunk + 4);
+
+  /* WAVE_FORMAT_EXTENSIBLE */
+  if (tag == 0xfffe)
+    {
+      if (len < 40 ||
+          memcmp (
+            chunk + 26, ksdataformat_tail,
+            sizeof (ksdataformat_tail)))
+        return -1;
+      tag = get_le16 (chunk + 24);
+    }
+
+  /* PCM */
+  if (tag == 1)
+    {
+      switch (bits)
+        {
+        case 8:  self->format = AD_PCM_U8; break;
+        case 16: self->format = AD_PCM_S16_LE; break;
+        case 24: self->format = AD_PCM_S24_LE; break;
+        case 32: self->format = AD_PCM_S32_LE; break;
+        default: return -1;
+        }
+    }
+  /* IEEE float */
+  else if (tag == 3)
+    {
+      switch (bits)
+        {
+        case 32: self->format = AD_PCM_F32_LE; break;
+        case 64: self->format = AD_PCM_F64_LE; break;
+        default: return -1;
+        }
+    }
+  else
+    return -1;
+
+  self->bit_depth = (int) bits;
+  self->frame_size =
+    (size_t) self->channels *
+    ad_pcm_get_sample_size (self->format);
+  return block_align == self->frame_size ? 0 : -1;
+}
+
+/**
+ * Parses a RIFF or RF64 WAVE file.
+ *
+ * @param data_len Set to the length of the data
+ *   chunk as written in the header.
+ *
+ * @return The offset of the data chunk, or 0 if
+ *   the file is not supported.
+ */
+static size_t
+parse_wav (
+  pcm_decoder *   self,
+  const uint8_t * buf,
+  size_t          size,
+  uint64_t *      data_len)
+{
+  if (size < 12 ||
+      (memcmp (buf, "RIFF", 4) &&
+       memcmp (buf, "RF64", 4)) ||
+      memcmp (buf + 8, "WAVE", 4))
+    return 0;
+
+  int      rf64 = !memcmp (buf, "RF64", 4);
+  int      have_fmt = 0;
+  uint64_t ds64_data_len = 0;
+  size_t   data_pos = 0;
+  size_t   pos = 12;
+  while (pos + 8 <= size)
+    {
+      const uint8_t * id = buf + pos;
+      uint64_t len = get_le32 (buf + pos + 4);
+      size_t   body = pos + 8;
+      size_t   avail = size - body;
+      if (!memcmp (id, "ds64", 4) && len >= 28 &&
+          avail >= 28)
+        ds64_data_len = get_le64 (buf + body + 8);
+      else if (!memcmp (id, "fmt ", 4))
+        {
+          if (parse_fmt (
+                self, buf + body,
+                (size_t) MIN (len, avail)))
+            return 0;
+          have_fmt = 1;
+        }
+      /* tempo of ACID loops */
+      else if (!memcmp (id, "acid", 4) && len >= 24 &&
+               avail >= 24)
+        {
+          uint32_t tempo = get_le32 (buf + body + 20);
+          memcpy (&self->bpm, &tempo, sizeof (float));
+        }
+      else if (!memcmp (id, "data", 4))
+        {
+          if (rf64 && len == 0xffffffff)
+            len = ds64_data_len;
+          data_pos = body;
+          *data_len = len;
+        }
+
+      if (len > avail)
+        break;
+      pos = body + (size_t) len + (len & 1);
+    }
+
+  return have_fmt ? data_pos : 0;
+}
+
+/**
+ * Parses a Sony Wave64 file.
+ *
+ * @see parse_wav().
+ */
+static size_t
+parse_w64 (
+  pcm_decoder *   self,
+  const uint8_t * buf,
+  size_t          size,
+  uint64_t *      data_len)
+{
+  if (size < 40 ||
+      memcmp (buf, w64_riff_guid, 16) ||
+      memcmp (buf + 24, "wave", 4) ||
+      memcmp (buf + 28, w64_guid_tail, 12))
+    return 0;
+
+  int    have_fmt = 0;
+  size_t data_pos = 0;
+  size_t pos = 40;
+  while (pos + 24 <= size)
+    {
+      const uint8_t * guid = buf + pos;
+      uint64_t len = get_le64 (buf + pos + 16);
+      size_t   body = pos + 24;
+      size_t   avail = size - body;
+      if (len < 24)
+        break;
+      len -= 24;
+
+      if (!memcmp (guid + 4, w64_guid_tail, 12))
+        {
+          if (!memcmp (guid, "fmt ", 4))
+            {
+              if (parse_fmt (
+                    self, buf + body,
+                    (size_t) MIN (len, avail)))
+                return 0;
+              have_fmt = 1;
+            }
+          else if (!memcmp (guid, "data", 4))
+            {
+              data_pos = body;
+              *data_len = len;
+            }
+        }
+
+      if (len > avail)
+        break;
+      /* chunks are aligned to 8 bytes */
+      pos = body + (((size_t) len + 7) & ~(size_t) 7);
+    }
+
+  return have_fmt ? data_pos : 0;
+}
+
+/**
+ * Parses an AIFF or AIFC file.
+ *
+ * @see parse_wav().
+ */
+static size_t
+parse_aiff (
+  pcm_decoder *   self,
+  const uint8_t * buf,
+  size_t          size,
+  uint64_t *      data_len)
+{
+  if (size < 12 ||
+      memcmp (buf, "FORM", 4) ||
+      (memcmp (buf + 8, "AIFF", 4) &&
+       memcmp (buf + 8, "AIFC", 4)))
+    return 0;
+
+  int      aifc = !memcmp (buf + 8, "AIFC", 4);
+  int      have_comm = 0;
+  uint64_t frames = 0;
+  size_t   data_pos = 0;
+  size_t   pos = 12;
+  while (pos + 8 <= size)
+    {
+      const uint8_t * id = buf + pos;
+      uint32_t len = get_be32 (buf + pos + 4);
+      size_t   body = pos + 8;
+      size_t   avail = size - body;
+      if (!memcmp (id, "COMM", 4))
+        {
+          if (len < 18 || avail < 18)
+            return 0;
+          const uint8_t * comm = buf + body;
+          self->channels = get_be16 (comm);
+          frames = get_be32 (comm + 2);
+          self->bit_depth = get_be16 (comm + 6);
+          self->sample_rate =
+            get_extended_rate (comm + 8);
+
+          /* sample sizes that are not a multiple of 8
+           * are left-aligned in whole bytes */
+          int big_endian = 1;
+          int is_float = 0;
+          if (aifc)
+            {
+              if (len < 22 || avail < 22)
+                return 0;
+              const uint8_t * type = comm + 18;
+              if (!memcmp (type, "sowt", 4))
+                big_endian = 0;
+              else if (!memcmp (type, "fl32", 4) ||
+                       !memcmp (type, "FL32", 4))
+                {
+                  is_float = 1;
+                  self->bit_depth = 32;
+                }
+              else if (!memcmp (type, "fl64", 4) ||
+                       !memcmp (type, "FL64", 4))
+                {
+                  is_float = 1;
+                  self->bit_depth = 64;
+                }
+              else if (memcmp (type, "NONE", 4) &&
+                       memcmp (type, "twos", 4))
+                return 0;
+            }
+
+          int bytes = (self->bit_depth + 7) / 8;
+          if (is_float)
+            self->format =
+              bytes == 4 ? AD_PCM_F32_BE : AD_PCM_F64_BE;
+          else if (bytes == 1)
+            self->format = AD_PCM_S8;
+          else if (bytes == 2)
+            self->format =
+              big_endian ? AD_PCM_S16_BE : AD_PCM_S16_LE;
+          else if (bytes == 3)
+            self->format =
+              big_endian ? AD_PCM_S24_BE : AD_PCM_S24_LE;
+          else if (bytes == 4)
+            self->format =
+              big_endian ? AD_PCM_S32_BE : AD_PCM_S32_LE;
+          else
+            return 0;
+          self->bit_depth = bytes * 8;
+          self->frame_size =
+            (size_t) self->channels * (size_t) bytes;
+          have_comm = 1;
+        }
+      else if (!memcmp (id, "SSND", 4))
+        {
+          if (len < 8 || avail < 8)
+            return 0;
+          uint32_t offset = get_be32 (buf + body);
+          if (offset > len - 8 || offset > avail - 8)
+            return 0;
+          data_pos = body + 8 + offset;
+          *data_len = len - 8 - offset;
+        }
+
+      if (len > avail)
+        break;
+      pos = body + len + (len & 1);
+    }
+
+  if (!have_comm || !data_pos)
+    return 0;
+
+  /* COMM has the exact number of frames */
+  if (*data_len > frames * self->frame_size)
+    *data_len = frames * self->frame_size;
+  return data_pos;
+}
+
+/**
+ * Parses the header of a file in memory and sets
+ * up the decoder to read from it.
+ *
+ * @return 0 if the file is supported, -1
+ *   otherwise.
+ */
+static int
+parse_header (
+  pcm_decoder *   self,
+  const uint8_t * buf,
+  size_t          size)
+{
+  uint64_t data_len = 0;
+  size_t   data_pos = parse_wav (self, buf, size, &data_len);
+  if (!data_pos)
+    data_pos = parse_w64 (self, buf, size, &data_len);
+  if (!data_pos)
+    data_pos = parse_aiff (self, buf, size, &data_len);
+  if (!data_pos || self->channels <= 0 ||
+      self->channels > MAX_CHANNELS ||
+      self->sample_rate <= 0 || !self->frame_size)
+    return -1;
+
+  /* files that were not finalized may have a wrong
+   * length */
+  if (data_len > size - data_pos)
+    data_len = size - data_pos;
+
+  self->data = buf + data_pos;
+  self->frames =
+    (int64_t) (data_len / self->frame_size);
+  return 0;
+}
+
+/**
+ * Maps a file and parses its header.
+ *
+ * @param start Offset the file starts at in \p fd.
+ *
+ * @return 0 if the file is supported, -1
+ *   otherwise.
+ */
+static int
+map_file (
+  pcm_decoder * self,
+  int           fd,
+  off_t         start)
+{
+#ifdef _WIN32
+  (void) self;
+  (void) fd;
+  (void) start;
+  return -1;
+#else
+  struct stat st;
+  if (fstat (fd, &st) || !S_ISREG (st.st_mode) ||
+      st.st_size <= start)
+    return -1;
+
+  self->map_size = (size_t) st.st_size;
+  self->map =
+    mmap (
+      NULL, self->map_size, PROT_READ, MAP_PRIVATE,
+      fd, 0);
+  if (self->map == MAP_FAILED)
+    {
+      self->map = NULL;
+      return -1;
+    }
+
+  if (parse_header (
+        self, (const uint8_t *) self->map + start,
+        self->map_size - (size_t) start))
+    {
+      munmap (self->map, self->map_size);
+      self->map = NULL;
+      return -1;
+    }
+
+  posix_madvise (
+    self->map, self->map_size,
+    POSIX_MADV_SEQUENTIAL);
+  return 0;
+#endif
+}
+
+static int
+ad_info_pcm (
+  void *      handle,
+  AudecInfo * nfo)
+{
+  pcm_decoder * self = (pcm_decoder *) handle;
+  if (!self)
+    return -1;
+  if (nfo)
+    {
+      nfo->channels = (unsigned int) self->channels;
+      nfo->frames = self->frames;
+      nfo->sample_rate = (unsigned int) self->sample_rate;
+      nfo->length =
+        (self->frames * 1000) / self->sample_rate;
+      nfo->bit_depth = self->bit_depth;
+      int64_t bit_rate =
+        (int64_t) self->bit_depth * self->channels *
+        self->sample_rate;
+      nfo->bit_rate = (int) MIN (bit_rate, INT_MAX);
+      nfo->bpm = self->bpm;
+      nfo->meta_data = NULL;
+    }
+  return 0;
+}
+
+static void *
+open_fd_at (
+  int          fd,
+  off_t        start,
+  AudecInfo *  nfo)
+{
+  pcm_decoder * self =
+    calloc (1, sizeof (pcm_decoder));
+  if (!self)
+    return NULL;
+
+  if (map_file (self, fd, start))
+    {
+      free (self);
+      return NULL;
+    }
+
+  ad_info_pcm (self, nfo);
+  return self;
+}
+
+static void *
+ad_open_pcm (
+  const char * filename,
+  AudecInfo *  nfo)
+{
+  int fd = open (filename, O_RDONLY);
+  if (fd < 0)
+    {
+      dbg (
+        AUDEC_LOG_LEVEL_ERROR,
+        "unable to open file '%s'.", filename);
+      return NULL;
+    }
+
+  /* the mapping stays valid after closing */
+  void * self = open_fd_at (fd, 0, nfo);
+  close (fd);
+  if (!self)
+    dbg (
+      AUDEC_LOG_LEVEL_ERROR,
+      "unable to map file '%s'.", filename);
+  return self;
+}
+
+static void *
+ad_open_memory_pcm (
+  const void * data,
+  size_t       size,
+  AudecInfo *  nfo,
+  unsigned int flags)
+{
+  (void) flags;
+  pcm_decoder * self =
+    calloc (1, sizeof (pcm_decoder));
+  if (!self)
+    return NULL;
+
+  if (parse_header (
+        self, (const uint8_t *) data, size))
+    {
+      free (self);
+      return NULL;
+    }
+
+  ad_info_pcm (self, nfo);
+  return self;
+}
+
+static void *
+ad_open_fd_pcm (
+  int          fd,
+  AudecInfo *  nfo,
+  unsigned int flags)
+{
+  (void) flags;
+  off_t start = lseek (fd, 0, SEEK_CUR);
+  if (start < 0)
+    return NULL;
+
+  return open_fd_at (fd, start, nfo);
+}
+
+static int
+ad_close_pcm (
+  void * handle)
+{
+  pcm_decoder * self = (pcm_decoder *) handle;
+  if (!self)
+    return -1;
+
+#ifndef _WIN32
+  if (self->map)
+    munmap (self->map, self->map_size);
+#endif
+  free (self);
+  return 0;
+}
+
+static int64_t
+ad_seek_pcm (
+  void *  handle,
+  int64_t pos)
+{
+  pcm_decoder * self = (pcm_decoder *) handle;
+  if (!self || pos < 0 || pos > self->frames)
+    return -1;
+
+  self->pos = pos;
+  return pos;
+}
+
+/**
+ * Returns the first sample to read and advances the
+ * read position by up to \p len samples.
+ *
+ * @param len Number of samples wanted, set to the
+ *   number available.
+ */
+static const uint8_t *
+advance (
+  pcm_decoder * self,
+  size_t *      len)
+{
+  size_t frames = *len / (size_t) self->channels;
+  size_t avail = (size_t) (self->frames - self->pos);
+  if (frames > avail)
+    frames = avail;
+
+  const uint8_t * src =
+    self->data + (size_t) self->pos * self->frame_size;
+  self->pos += (int64_t) frames;
+  *len = frames * (size_t) self->channels;
+  return src;
+}
+
+static ssize_t
+ad_read_pcm (
+  void *  handle,
+  float * d,
+  size_t  len)
+{
+  pcm_decoder * self = (pcm_decoder *) handle;
+  if (!self)
+    return -1;
+
+  const uint8_t * src = advance (self, &len);
+  ad_pcm_to_float (src, self->format, d, len);
+  return (ssize_t) len;
+}
+
+static ssize_t
+ad_read_short_pcm (
+  void *    handle,
+  int16_t * d,
+  size_t    len)
+{
+  pcm_decoder * self = (pcm_decoder *) handle;
+  if (!self)
+    return -1;
+
+  const uint8_t * src = advance (self, &len);
+  ad_pcm_to_short (src, self->format, d, len);
+  return (ssize_t) len;
+}
+
+static ssize_t
+ad_read_int_pcm (
+  void *    handle,
+  int32_t * d,
+  size_t    len)
+{
+  pcm_decoder * self = (pcm_decoder *) handle;
+  if (!self)
+    return -1;
+
+  const uint8_t * src = advance (self, &len);
+  ad_pcm_to_int (src, self->format, d, len);
+  return (ssize_t) len;
+}
+
+static ssize_t
+ad_read_double_pcm (
+  void *   handle,
+  double * d,
+  size_t   len)
+{
+  pcm_decoder * self = (pcm_decoder *) handle;
+  if (!self)
+    return -1;
+
+  const uint8_t * src = advance (self, &len);
+  ad_pcm_to_double (src, self->format, d, len);
+  return (ssize_t) len;
+}
+
+static const float *
+ad_get_mapped_frames_pcm (
+  void *    handle,
+  int64_t * num_frames)
+{
+  pcm_decoder * self = (pcm_decoder *) handle;
+  if (!self)
+    return NULL;
+
+#if defined (__BYTE_ORDER__) && \
+  __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  if (self->format == AD_PCM_F32_LE &&
+      (uintptr_t) self->data % sizeof (float) == 0)
+    {
+      *num_frames = self->frames;
+      return (const float *) (const void *) self->data;
+    }
+#endif
+
+  return NULL;
+}
+
+/**
+ * Scores files whose header this backend can
+ * decode above libsndfile, and all others 0.
+ */
+static int
+ad_eval_pcm (
+  const char * f)
+{
+  if (strstr (f, "://"))
+    return 0;
+
+  int fd = open (f, O_RDONLY);
+  if (fd < 0)
+    return 0;
+
+  pcm_decoder self;
+  memset (&self, 0, sizeof (self));
+  int ret = map_file (&self, fd, 0);
+  close (fd);
+  if (ret)
+    return 0;
+
+#ifndef _WIN32
+  munmap (self.map, self.map_size);
+#endif
+  return 110;
+}
+
+static const ad_plugin ad_pcm = {
+  .eval = &ad_eval_pcm,
+  .open = &ad_open_pcm,
+  .open_memory = &ad_open_memory_pcm,
+  .open_fd = &ad_open_fd_pcm,
+  .close = &ad_close_pcm,
+  .info = &ad_info_pcm,
+  .seek = &ad_seek_pcm,
+  .read = &ad_read_pcm,
+  .read_short = &ad_read_short_pcm,
+  .read_int = &ad_read_int_pcm,
+  .read_double = &ad_read_double_pcm,
+  .get_mapped_frames = &ad_get_mapped_frames_pcm,
+};
+
+const ad_plugin *
+adp_get_pcm (void)
+{
+  return &ad_pcm;
+}
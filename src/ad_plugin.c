@@ -47,13 +47,34 @@
 
 #include <samplerate.h>
 
+#include "ad_dsp.h"
+#include "ad_index_cache.h"
 #include "ad_plugin.h"
+#include "ad_resampler.h"
+#include "ad_thread_pool.h"
 
 AudecLogLevel ad_log_level =
   AUDEC_LOG_LEVEL_ERROR;
 
 audec_log_fn_t log_fn = NULL;
 
+/** Default number of frames decoded and processed
+ * at a time when streaming. */
+#define STREAM_BLOCK_SIZE 4096
+
+/** Range of block sizes accepted by
+ * audec_set_block_size(). */
+#define MIN_BLOCK_SIZE 256
+#define MAX_BLOCK_SIZE 65536
+
+/** Number of frames (at the file's sample rate when
+ * upsampling) decoded before a range so that the
+ * sinc filter history matches a full-file render.
+ * This covers the half-length of the
+ * SRC_SINC_BEST_QUALITY filter and of the built-in
+ * polyphase filters. */
+#define RESAMPLE_PREROLL 256
+
 #define UNUSED(x) (void)(x)
 int     ad_eval_null(const char *f) { UNUSED(f); return -1; }
 void *  ad_open_null(const char *f, AudecInfo *n) { UNUSED(f); UNUSED(n); return NULL; }
@@ -63,6 +84,70 @@ int64_t ad_seek_null(void *x, int64_t p) { UNUSED(x); UNUSED(p); return -1; }
 ssize_t ad_read_null(void *x, float*d, size_t s) { UNUSED(x); UNUSED(d); UNUSED(s); return -1;}
 
 
+/**
+ * Resampler for a group of consecutive output
+ * channels.
+ */
+typedef struct resample_group
+{
+  ad_resampler * resampler;
+
+  /** First output channel of the group. */
+  unsigned int  first_channel;
+
+  /** Number of channels in the group. */
+  unsigned int  channels;
+
+  /** Interleaved input frames of the group's
+   * channels. */
+  float *       in;
+
+  /** Interleaved resampled frames of the group's
+   * channels. */
+  float *       out;
+
+  /** Results of the last ad_resampler_process()
+   * call. */
+  size_t        frames_used;
+  ssize_t       frames_generated;
+} resample_group;
+
+/**
+ * Streaming resampler. Runs one resampler per
+ * channel group, on a worker pool if there are
+ * several groups, and joins their output.
+ */
+typedef struct stream_resampler
+{
+  /** Sample rate the resamplers convert to, before
+   * applying the varispeed. */
+  unsigned int     out_rate;
+
+  /** Whether the ratio can change per block. */
+  int              variable_ratio;
+
+
+  /** Worker pool, or NULL with a single group. */
+  ad_thread_pool * pool;
+
+  resample_group * groups;
+  unsigned int     num_groups;
+
+  /** Decoded frames not consumed yet by the
+   * resamplers, in the handle's src_in block. */
+  size_t           in_pos;
+  size_t           in_len;
+
+  /** Whether the backend has no more frames. */
+  int              end_of_input;
+
+  /** Whether the resamplers have been flushed. */
+  int              done;
+
+  /** Frames per block. */
+  size_t           block_size;
+} stream_resampler;
+
 typedef struct adecoder
 {
   /** Decoder backend plugin. */
@@ -71,14 +156,138 @@ typedef struct adecoder
   /** Backend data, such as SF file. */
   void *            data;
 
+  /** Number of channels in the file. */
+  unsigned int      channels;
+
+  /** Number of channels returned by reads, after
+   * channel selection or mixing. */
+  unsigned int      out_channels;
+
+  /** File channel to read for each output channel,
+   * or NULL. */
+  unsigned int *    channel_map;
+
+  /** Mix matrix of out_channels rows and channels
+   * columns, or NULL. */
+  float *           mix_matrix;
+
+  /** Block of frames with the file's channels read
+   * before selecting or mixing channels. */
+  float *           mix_in;
+
+  /** Sample rate of the file. */
+  unsigned int      sample_rate;
+
+  /** Number of frames each stage processes at a
+   * time. */
+  size_t            block_size;
+
+  /** Gain applied to decoded frames. */
+  float             gain;
+
+  /** Sample rate to resample streamed reads to, or
+   * 0 to return frames at the file's sample
+   * rate. */
+  unsigned int      target_sample_rate;
+
+  /** Resampler quality. */
+  AudecResampleQuality quality;
+
+  /** Block buffer decoded frames are read into
+   * before resampling. */
+  float *           src_in;
+
+  /** Number of threads to resample on. */
+  unsigned int      resample_threads;
+
+  /** Number of threads whole-file reads decode
+   * on, if the backend supports it. */
+  unsigned int      decode_threads;
+
+  /** Whether whole-file reads return exactly
+   * ceil (frames * ratio) frames. */
+  int               exact_length;
+
+  /** Whether streamed reads go through a variable
+   * ratio resampler, and the playback speed it
+   * applies. */
+  int               varispeed;
+  double            speed;
+
+  /** Streaming resampler, created on first use. */
+  stream_resampler * resampler;
+
+  /** Interleaved float block used when the output
+   * needs converting (planar or other sample
+   * formats). */
+  float *           scratch;
+
   /* Log function. */
   audec_log_fn_t    log_fn;
 } adecoder;
 
+static void
+stream_resampler_reset (
+  stream_resampler * self)
+{
+  for (unsigned int i = 0; i < self->num_groups; i++)
+    ad_resampler_reset (self->groups[i].resampler);
+  self->in_pos = 0;
+  self->in_len = 0;
+  self->end_of_input = 0;
+  self->done = 0;
+}
+
+static void
+stream_resampler_free (
+  stream_resampler * self)
+{
+  if (!self)
+    return;
+
+  for (unsigned int i = 0; i < self->num_groups; i++)
+    {
+      resample_group * group = &self->groups[i];
+      ad_resampler_free (group->resampler);
+      free (group->in);
+      free (group->out);
+    }
+  free (self->groups);
+  if (self->pool)
+    ad_thread_pool_free (self->pool);
+  free (self);
+}
+
+/**
+ * Deletes the streaming resampler. It is recreated
+ * on the next resampled read.
+ */
+static void
+free_resampler (
+  adecoder * decoder)
+{
+  stream_resampler_free (decoder->resampler);
+  decoder->resampler = NULL;
+}
+
 /* samplecat api */
 
 void audec_init() { /* global init */ }
 
+void
+audec_set_resampler_pool_size (
+  size_t max_resamplers)
+{
+  ad_resampler_set_pool_size (max_resamplers);
+}
+
+int
+audec_set_index_cache_dir (
+  const char * dir)
+{
+  return ad_index_cache_set_dir (dir);
+}
+
 static ad_plugin const *
 choose_backend (
   const char * fn)
@@ -87,6 +296,15 @@ choose_backend (
   ad_plugin const * plugin = NULL;
   max = 0;
 
+  /* uncompressed files whose header it parses go
+   * to the PCM backend ahead of libsndfile */
+  val = adp_get_pcm ()->eval (fn);
+  if (val > max)
+    {
+      max = val;
+      plugin = adp_get_pcm ();
+    }
+
   val = adp_get_sndfile()->eval(fn);
   if (val > max)
     {
@@ -113,10 +331,37 @@ choose_backend (
   return plugin;
 }
 
+/**
+ * Finishes setting up a handle whose backend
+ * opened the file.
+ */
+static AudecHandle *
+init_decoder (
+  adecoder *  decoder,
+  AudecInfo * nfo)
+{
+  decoder->channels = nfo->channels;
+  decoder->out_channels = nfo->channels;
+  decoder->sample_rate = nfo->sample_rate;
+  decoder->speed = 1.0;
+  decoder->block_size = STREAM_BLOCK_SIZE;
+  decoder->gain = 1.f;
+  return (AudecHandle *) decoder;
+}
+
 AudecHandle *
 audec_open (
   const char * filename,
   AudecInfo *  nfo)
+{
+  return audec_open_with_flags (filename, nfo, 0);
+}
+
+AudecHandle *
+audec_open_with_flags (
+  const char *   filename,
+  AudecInfo *    nfo,
+  unsigned int   flags)
 {
   adecoder * decoder =
     calloc (1, sizeof (adecoder));
@@ -131,13 +376,154 @@ audec_open (
       free(decoder);
       return NULL;
     }
-  decoder->data = decoder->plugin->open (filename, nfo);
+  if (decoder->plugin->open_with_flags)
+    decoder->data =
+      decoder->plugin->open_with_flags (
+        filename, nfo, flags);
+  else
+    decoder->data = decoder->plugin->open (filename, nfo);
   if (!decoder->data)
     {
       free (decoder);
       return NULL;
     }
-  return (AudecHandle *) decoder;
+  return init_decoder (decoder, nfo);
+}
+
+/**
+ * A file that is not opened by name.
+ */
+typedef struct stream_source
+{
+  /** Contents of a file in memory. */
+  const void *    data;
+  size_t          size;
+
+  /** Callbacks to read the file through. */
+  const AudecIO * io;
+  void *          user_data;
+
+  /** Descriptor to read the file from, or -1, and
+   * its offset when opened, or -1 if it cannot
+   * seek. */
+  int             fd;
+  int64_t         fd_start;
+} stream_source;
+
+/**
+ * Opens a file from memory, callbacks or a
+ * descriptor with the first backend that
+ * recognizes the contents, in the same order of
+ * preference as for files opened by name.
+ */
+static AudecHandle *
+open_stream (
+  const stream_source * src,
+  AudecInfo *           nfo,
+  unsigned int          flags)
+{
+  adecoder * decoder =
+    calloc (1, sizeof (adecoder));
+  if (!decoder)
+    return NULL;
+
+  ad_plugin const * plugins[] = {
+    adp_get_pcm (),
+    adp_get_sndfile (),
+    adp_get_minimp3 (),
+  };
+  int fd_tried = 0;
+  for (size_t i = 0;
+       i < sizeof (plugins) / sizeof (plugins[0]); i++)
+    {
+      ad_plugin const * plugin = plugins[i];
+      audec_clear_nfo (nfo);
+      if (src->io && plugin->open_io)
+        decoder->data =
+          plugin->open_io (
+            src->io, src->user_data, nfo, flags);
+      else if (src->fd >= 0 && plugin->open_fd)
+        {
+          /* the PCM backend maps the file, which
+           * needs a descriptor that can seek */
+          if (src->fd_start < 0 &&
+              plugin == adp_get_pcm ())
+            continue;
+
+          /* the previous backend may have read from
+           * it */
+          if (fd_tried &&
+              (src->fd_start < 0 ||
+               lseek (
+                 src->fd, (off_t) src->fd_start,
+                 SEEK_SET) < 0))
+            break;
+          fd_tried = 1;
+          decoder->data =
+            plugin->open_fd (src->fd, nfo, flags);
+        }
+      else if (src->data && plugin->open_memory)
+        decoder->data =
+          plugin->open_memory (
+            src->data, src->size, nfo, flags);
+      if (decoder->data)
+        {
+          decoder->plugin = plugin;
+          return init_decoder (decoder, nfo);
+        }
+    }
+
+  dbg (
+    AUDEC_LOG_LEVEL_ERROR,
+    "no decoder backend recognized the data");
+  free (decoder);
+  return NULL;
+}
+
+AudecHandle *
+audec_open_memory (
+  const void *   data,
+  size_t         size,
+  AudecInfo *    nfo,
+  unsigned int   flags)
+{
+  if (!data || !size || !nfo)
+    return NULL;
+
+  stream_source src = {
+    .data = data, .size = size, .fd = -1 };
+  return open_stream (&src, nfo, flags);
+}
+
+AudecHandle *
+audec_open_io (
+  const AudecIO * io,
+  void *          user_data,
+  AudecInfo *     nfo,
+  unsigned int    flags)
+{
+  if (!io || !io->read || !io->seek || !nfo)
+    return NULL;
+
+  stream_source src = {
+    .io = io, .user_data = user_data, .fd = -1 };
+  return open_stream (&src, nfo, flags);
+}
+
+AudecHandle *
+audec_open_fd (
+  int            fd,
+  AudecInfo *    nfo,
+  unsigned int   flags)
+{
+  if (fd < 0 || !nfo)
+    return NULL;
+
+  stream_source src = {
+    .fd = fd,
+    .fd_start = (int64_t) lseek (fd, 0, SEEK_CUR),
+  };
+  return open_stream (&src, nfo, flags);
 }
 
 int
@@ -160,6 +546,12 @@ audec_close (
   if (!decoder)
     return -1;
   int ret = decoder->plugin->close (decoder->data);
+  free_resampler (decoder);
+  free (decoder->src_in);
+  free (decoder->scratch);
+  free (decoder->channel_map);
+  free (decoder->mix_matrix);
+  free (decoder->mix_in);
   free (decoder);
   return ret;
 }
@@ -171,275 +563,2179 @@ audec_seek (
 {
   adecoder * decoder = (adecoder*) handle;
   if (!decoder) return -1;
+
+  /* drop any frames buffered in the resampler so
+   * streaming restarts cleanly at the new
+   * position */
+  if (decoder->resampler)
+    stream_resampler_reset (decoder->resampler);
+
   return decoder->plugin->seek (decoder->data, pos);
 }
 
-/**
- * Returns the size of the buffer that must be
- * allocated to load the file with the given
- * sample rate.
- */
-static ssize_t
-get_buf_size_for_sample_rate (
-  AudecInfo *  nfo,
-  unsigned int sample_rate)
+int
+audec_set_target_sample_rate (
+  AudecHandle * handle,
+  int           sample_rate)
 {
-  if (sample_rate == nfo->sample_rate)
+  adecoder * decoder = (adecoder*) handle;
+  if (!decoder)
+    return -1;
+
+  unsigned int out_rate =
+    sample_rate <= 0 ?
+      decoder->sample_rate :
+      (unsigned int) sample_rate;
+
+  /* the streaming resampler also applies the
+   * varispeed */
+  double resample_ratio =
+    (double) out_rate / decoder->sample_rate;
+  if (src_is_valid_ratio (resample_ratio) == 0 ||
+      (decoder->varispeed &&
+       src_is_valid_ratio (
+         resample_ratio / decoder->speed) == 0))
     {
-      return nfo->frames * nfo->channels;
+      dbg (
+        AUDEC_LOG_LEVEL_ERROR,
+        "Sample rate change out of valid "
+        "range.");
+      return -1;
     }
-  else
-    {
-      double resample_ratio =
-        (double) sample_rate / nfo->sample_rate;
-      if (fabs (resample_ratio - 1.0) < 1e-20)
-        {
-          /* no sample rate change needed */
-          return
-            (ssize_t) nfo->frames *
-            (ssize_t) nfo->channels;
-        }
-      if (src_is_valid_ratio (resample_ratio) == 0)
-        {
-          dbg (
-            AUDEC_LOG_LEVEL_ERROR,
-            "Sample rate change out of valid "
-            "range.");
-          return -1;
-        }
 
-      return
-        (ssize_t)
-        ((double) nfo->frames * resample_ratio *
-         (double) nfo->channels);
+  if (out_rate == decoder->sample_rate)
+    {
+      decoder->target_sample_rate = 0;
+      return 0;
     }
-}
 
-typedef struct SrcCallbackData
-{
-  float *    in_frames;
-  size_t     num_in_frames;
-} SrcCallbackData;
-
-static long
-src_cb (
-  SrcCallbackData * data,
-  float **          audio)
-{
-  *audio = &(data->in_frames[0]);
+  /* the streaming resampler is recreated for the
+   * new rate on the next read */
+  decoder->target_sample_rate =
+    (unsigned int) sample_rate;
 
-  return data->num_in_frames;
+  return 0;
 }
 
-ssize_t
-audec_read (
-  AudecHandle * handle,
-  float **      out,
-  int           sample_rate)
+int
+audec_set_resample_quality (
+  AudecHandle *        handle,
+  AudecResampleQuality quality)
 {
-  adecoder *decoder = (adecoder*) handle;
+  adecoder * decoder = (adecoder*) handle;
   if (!decoder)
     return -1;
 
-  if (*out != NULL)
+  if (ad_resampler_get_src_converter (quality) < 0)
     {
       dbg (
         AUDEC_LOG_LEVEL_ERROR,
-        "Please set 'out' to NULL before calling "
-        "audec_read()");
+        "Invalid resample quality %d", quality);
       return -1;
     }
 
-  /* get the info */
-  AudecInfo nfo;
-  audec_info ((AudecHandle *) decoder, &nfo);
+  if (quality == decoder->quality)
+    return 0;
 
-  /* read the frames */
-  size_t in_len =
-    (size_t) (nfo.frames * nfo.channels);
-  float * in = malloc (in_len * sizeof (float));
-  ssize_t ret = /* note: includes channels */
-    decoder->plugin->read (
-      decoder->data, in, in_len);
+  /* the converter type is fixed at creation so the
+   * streaming resampler must be recreated */
+  free_resampler (decoder);
+  decoder->quality = quality;
 
-  /* verify that the frames were all read */
-  if (ret != (ssize_t) in_len)
-    {
-      dbg (
-        AUDEC_LOG_LEVEL_DEBUG,
-        "Number of read in frames %zu not equal to "
-        "given buf size %zd",
-        ret, in_len);
-    }
+  return 0;
+}
+
+/**
+ * Returns the sample rate streamed reads are
+ * resampled to, before applying the varispeed.
+ */
+static unsigned int
+get_stream_out_rate (
+  adecoder * decoder)
+{
+  return
+    decoder->target_sample_rate ?
+      decoder->target_sample_rate :
+      decoder->sample_rate;
+}
 
-  if (ret > (ssize_t) in_len)
+int
+audec_set_block_size (
+  AudecHandle * handle,
+  size_t        block_size)
+{
+  adecoder * decoder = (adecoder*) handle;
+  if (!decoder)
+    return -1;
+
+  if (block_size < MIN_BLOCK_SIZE ||
+      block_size > MAX_BLOCK_SIZE)
     {
       dbg (
         AUDEC_LOG_LEVEL_ERROR,
-        "Number of read in frames %zu greater than "
-        "given buf size %zd",
-        ret, in_len);
-      free (in);
+        "Block size %zu out of range [%d, %d]",
+        block_size, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE);
       return -1;
     }
 
-  /* resample if required */
-  if (sample_rate > 0 &&
-      sample_rate != (int) nfo.sample_rate)
-    {
-      ssize_t out_buf_size =
-        get_buf_size_for_sample_rate (
-          &nfo, (unsigned int) sample_rate);
-      if (out_buf_size < 0)
-        {
-          free (in);
-          return -1;
-        }
-      else
-        {
-          int err;
-          SrcCallbackData data = {
-            .in_frames = in,
-            .num_in_frames = nfo.frames,
-          };
-          SRC_STATE * state =
-            src_callback_new (
-              (src_callback_t) src_cb,
-              SRC_SINC_BEST_QUALITY,
-              (int) nfo.channels, &err, &data);
-          if (!state)
-            {
-              dbg (
-                AUDEC_LOG_LEVEL_ERROR,
-                "Failed to create a src callback: "
-                "%s", src_strerror (err));
-              free (in);
-              return -1;
-            }
-
-          double resample_ratio =
-            (1.0 * (double) sample_rate) /
-            nfo.sample_rate;
-          *out =
-            malloc (
-              (size_t) out_buf_size *
-              sizeof (float));
+  if (block_size == decoder->block_size)
+    return 0;
 
-          /* start reading */
-          ssize_t frames_read = -1;
-          ssize_t total_read = 0;
-          ssize_t frames_to_read = 0;
-          ssize_t num_out_frames =
-            (out_buf_size / (ssize_t) nfo.channels);
-          do
-            {
-              frames_to_read =
-                MIN (
-                  6000,
-                  num_out_frames - total_read);
-              frames_read =
-                src_callback_read (
-                  state, resample_ratio,
-                  frames_to_read,
-                  &((*out)[total_read * nfo.channels]));
-
-              /* handle errors */
-              int err_ret =
-                src_error (state);
-              if (err_ret)
-                {
-                  dbg (
-                    AUDEC_LOG_LEVEL_ERROR,
-                    "An error occurred during "
-                    "resampling: %s",
-                    src_strerror (err_ret));
-                  src_delete (state);
-                  free (in);
-                  free (*out);
-                  *out = NULL;
-                  return -1;
-                }
-
-              total_read += frames_read;
-
-              if (frames_read == -1)
-                break;
-
-            } while (frames_read > 0);
-          src_delete (state);
-          free (in);
-
-          if (total_read != num_out_frames)
-            {
-              dbg (
-                AUDEC_LOG_LEVEL_INFO,
-                "Total frames read (%zu) and out "
-                "frames expected (%zu) do not match",
-                total_read, num_out_frames);
-            }
-          if (frames_read == -1)
-            {
-              dbg (
-                AUDEC_LOG_LEVEL_ERROR,
-                "An error has occurred in "
-                "resampling: frames read == -1");
-              free (*out);
-              *out = NULL;
-              return -1;
-            }
-          ret = total_read;
+  /* the block buffers are reallocated on the next
+   * read */
+  free_resampler (decoder);
+  free (decoder->src_in);
+  decoder->src_in = NULL;
+  free (decoder->mix_in);
+  decoder->mix_in = NULL;
+  free (decoder->scratch);
+  decoder->scratch = NULL;
+  decoder->block_size = block_size;
 
-          dbg (
-            AUDEC_LOG_LEVEL_INFO,
-            "%zu frames read after resampling "
-            "(out buffer size %zu)",
-            total_read, out_buf_size);
-        }
-    }
-  else
-    {
-      *out = in;
-      ret = nfo.frames;
+  return 0;
+}
+
+int
+audec_set_gain (
+  AudecHandle * handle,
+  float         gain)
+{
+  adecoder * decoder = (adecoder*) handle;
+  if (!decoder)
+    return -1;
+
+  decoder->gain = gain;
+
+  return 0;
+}
 
+int
+audec_set_varispeed (
+  AudecHandle * handle,
+  double        speed)
+{
+  adecoder * decoder = (adecoder*) handle;
+  if (!decoder)
+    return -1;
+
+  if (!(speed > 0.0) ||
+      src_is_valid_ratio (
+        get_stream_out_rate (decoder) /
+        (decoder->sample_rate * speed)) == 0)
+    {
       dbg (
-        AUDEC_LOG_LEVEL_INFO,
-        "No resampling done, returning %" PRIi64 " frames "
-        "(out buffer size %zu)",
-        nfo.frames, ret);
+        AUDEC_LOG_LEVEL_ERROR,
+        "Invalid varispeed %f", speed);
+      return -1;
     }
 
-  return ret;
+  /* the resampler is switched to a variable ratio
+   * once so that later speed changes keep its
+   * state */
+  decoder->varispeed = 1;
+  decoder->speed = speed;
+
+  return 0;
 }
 
-/*
- *  side-effects: allocates buffer
- */
-ssize_t
-audec_read_mono_dbl (
-  void *      sf,
-  AudecInfo * nfo,
-  double *    d,
-  size_t      len,
-  int         sample_rate)
+int
+audec_set_resample_threads (
+  AudecHandle * handle,
+  unsigned int  num_threads)
 {
-  unsigned int c,f;
-  unsigned int chn = nfo->channels;
-  if (len<1) return 0;
+  adecoder * decoder = (adecoder*) handle;
+  if (!decoder)
+    return -1;
 
-  static float *buf = NULL;
+  if (num_threads == 0)
+    num_threads = 1;
+  if (num_threads == decoder->resample_threads)
+    return 0;
 
-  len = audec_read (sf, &buf, sample_rate);
+  free_resampler (decoder);
+  decoder->resample_threads = num_threads;
 
-  for (f=0;f< (len/chn);f++) {
-    double val=0.0;
-    for (c=0;c<chn;c++) {
-      val+=buf[f*chn + c];
-    }
-    d[f]= val/chn;
-  }
-  return len/chn;
+  return 0;
 }
 
+int
+audec_set_decode_threads (
+  AudecHandle * handle,
+  unsigned int  num_threads)
+{
+  adecoder * decoder = (adecoder*) handle;
+  if (!decoder)
+    return -1;
+
+  decoder->decode_threads = num_threads;
+
+  return 0;
+}
+
+/**
+ * Drops the streaming resampler and the blocks
+ * sized for the output channels, after the number
+ * of output channels changed.
+ */
+static void
+reset_output_channels (
+  adecoder *   decoder,
+  unsigned int out_channels)
+{
+  free_resampler (decoder);
+  free (decoder->src_in);
+  decoder->src_in = NULL;
+  free (decoder->scratch);
+  decoder->scratch = NULL;
+  free (decoder->channel_map);
+  decoder->channel_map = NULL;
+  free (decoder->mix_matrix);
+  decoder->mix_matrix = NULL;
+  decoder->out_channels = out_channels;
+}
+
+int
+audec_set_channel_selection (
+  AudecHandle *        handle,
+  const unsigned int * channels,
+  unsigned int         num_channels)
+{
+  adecoder * decoder = (adecoder*) handle;
+  if (!decoder)
+    return -1;
+
+  if (!channels || num_channels == 0)
+    {
+      reset_output_channels (
+        decoder, decoder->channels);
+      return 0;
+    }
+
+  for (unsigned int i = 0; i < num_channels; i++)
+    {
+      if (channels[i] >= decoder->channels)
+        {
+          dbg (
+            AUDEC_LOG_LEVEL_ERROR,
+            "Invalid channel %u (file has %u "
+            "channels)",
+            channels[i], decoder->channels);
+          return -1;
+        }
+    }
+
+  reset_output_channels (decoder, num_channels);
+  decoder->channel_map =
+    malloc (num_channels * sizeof (unsigned int));
+  memcpy (
+    decoder->channel_map, channels,
+    num_channels * sizeof (unsigned int));
+
+  return 0;
+}
+
+int
+audec_set_mix_matrix (
+  AudecHandle * handle,
+  const float * matrix,
+  unsigned int  num_channels)
+{
+  adecoder * decoder = (adecoder*) handle;
+  if (!decoder)
+    return -1;
+
+  if (!matrix || num_channels == 0)
+    {
+      reset_output_channels (
+        decoder, decoder->channels);
+      return 0;
+    }
+
+  size_t size =
+    (size_t) num_channels * decoder->channels *
+    sizeof (float);
+  reset_output_channels (decoder, num_channels);
+  decoder->mix_matrix = malloc (size);
+  memcpy (decoder->mix_matrix, matrix, size);
+
+  return 0;
+}
+
+unsigned int
+audec_get_output_channels (
+  AudecHandle * handle)
+{
+  adecoder * decoder = (adecoder*) handle;
+  if (!decoder)
+    return 0;
+
+  return decoder->out_channels;
+}
+
+/**
+ * Returns the size of the buffer that must be
+ * allocated to load the file with the given
+ * sample rate.
+ */
+static ssize_t
+get_buf_size_for_sample_rate (
+  AudecInfo *  nfo,
+  unsigned int sample_rate)
+{
+  if (sample_rate == nfo->sample_rate)
+    {
+      return nfo->frames * nfo->channels;
+    }
+  else
+    {
+      double resample_ratio =
+        (double) sample_rate / nfo->sample_rate;
+      if (fabs (resample_ratio - 1.0) < 1e-20)
+        {
+          /* no sample rate change needed */
+          return
+            (ssize_t) nfo->frames *
+            (ssize_t) nfo->channels;
+        }
+      if (src_is_valid_ratio (resample_ratio) == 0)
+        {
+          dbg (
+            AUDEC_LOG_LEVEL_ERROR,
+            "Sample rate change out of valid "
+            "range.");
+          return -1;
+        }
+
+      return
+        (ssize_t)
+        ((double) nfo->frames * resample_ratio *
+         (double) nfo->channels);
+    }
+}
+
+/**
+ * Reads up to \p max_frames frames from the backend
+ * at the file's sample rate.
+ */
+static ssize_t
+read_plugin_frames (
+  adecoder * decoder,
+  float *    dst,
+  size_t     max_frames)
+{
+  size_t channels = decoder->channels;
+
+  /* backends may return short reads before the
+   * end of the file, so keep reading until the
+   * buffer is full or nothing is returned */
+  size_t total_read = 0;
+  while (total_read < max_frames)
+    {
+      ssize_t ret = /* note: includes channels */
+        decoder->plugin->read (
+          decoder->data, &dst[total_read * channels],
+          (max_frames - total_read) * channels);
+      if (ret < 0)
+        {
+          dbg (
+            AUDEC_LOG_LEVEL_ERROR,
+            "Failed to read from backend");
+          return -1;
+        }
+      if (ret == 0)
+        break;
+
+      total_read += (size_t) ret / channels;
+    }
+
+  return (ssize_t) total_read;
+}
+
+/**
+ * Reads up to \p max_frames frames from the backend
+ * and selects or mixes the channels if needed.
+ */
+static ssize_t
+read_mixed_frames (
+  adecoder * decoder,
+  float *    dst,
+  size_t     max_frames)
+{
+  if (!decoder->channel_map && !decoder->mix_matrix)
+    {
+      if (decoder->gain == 1.f)
+        return
+          read_plugin_frames (
+            decoder, dst, max_frames);
+
+      /* apply the gain block by block while the
+       * frames are still in cache */
+      size_t total_read = 0;
+      while (total_read < max_frames)
+        {
+          float * cur =
+            &dst[total_read * decoder->out_channels];
+          ssize_t frames_read =
+            read_plugin_frames (
+              decoder, cur,
+              MIN (
+                max_frames - total_read,
+                decoder->block_size));
+          if (frames_read < 0)
+            return -1;
+          if (frames_read == 0)
+            break;
+
+          ad_apply_gain (
+            cur,
+            (size_t) frames_read * decoder->out_channels,
+            decoder->gain);
+          total_read += (size_t) frames_read;
+        }
+
+      return (ssize_t) total_read;
+    }
+
+  if (!decoder->mix_in)
+    decoder->mix_in =
+      malloc (
+        decoder->block_size * decoder->channels *
+        sizeof (float));
+
+  size_t total_read = 0;
+  while (total_read < max_frames)
+    {
+      ssize_t frames_read =
+        read_plugin_frames (
+          decoder, decoder->mix_in,
+          MIN (
+            max_frames - total_read,
+            decoder->block_size));
+      if (frames_read < 0)
+        return -1;
+      if (frames_read == 0)
+        break;
+
+      float * cur =
+        &dst[total_read * decoder->out_channels];
+      if (decoder->channel_map)
+        ad_select_channels (
+          decoder->mix_in, decoder->channels, cur,
+          decoder->channel_map,
+          decoder->out_channels,
+          (size_t) frames_read);
+      else
+        ad_mix_channels (
+          decoder->mix_in, decoder->channels, cur,
+          decoder->mix_matrix, decoder->out_channels,
+          (size_t) frames_read);
+      if (decoder->gain != 1.f)
+        ad_apply_gain (
+          cur,
+          (size_t) frames_read * decoder->out_channels,
+          decoder->gain);
+      total_read += (size_t) frames_read;
+    }
+
+  return (ssize_t) total_read;
+}
+
+/**
+ * Creates the streaming resampler, with one group
+ * of consecutive channels per thread.
+ */
+static stream_resampler *
+stream_resampler_new (
+  adecoder * decoder)
+{
+  stream_resampler * self =
+    calloc (1, sizeof (stream_resampler));
+  unsigned int channels = decoder->out_channels;
+  self->out_rate = get_stream_out_rate (decoder);
+  self->variable_ratio = decoder->varispeed;
+  self->num_groups =
+    MAX (
+      1, MIN (decoder->resample_threads, channels));
+  self->groups =
+    calloc (self->num_groups, sizeof (resample_group));
+  self->block_size = decoder->block_size;
+
+  /* spread the channels as evenly as possible */
+  unsigned int first_channel = 0;
+  for (unsigned int i = 0; i < self->num_groups; i++)
+    {
+      resample_group * group = &self->groups[i];
+      group->first_channel = first_channel;
+      group->channels =
+        channels / self->num_groups +
+        (i < channels % self->num_groups ? 1 : 0);
+      first_channel += group->channels;
+
+      if (self->num_groups > 1)
+        {
+          group->in =
+            malloc (
+              self->block_size * group->channels *
+              sizeof (float));
+          group->out =
+            malloc (
+              self->block_size * group->channels *
+              sizeof (float));
+        }
+      group->resampler =
+        ad_resampler_new (
+          decoder->quality, group->channels,
+          decoder->sample_rate, self->out_rate,
+          self->variable_ratio);
+      if (!group->resampler)
+        {
+          stream_resampler_free (self);
+          return NULL;
+        }
+    }
+
+  if (self->num_groups > 1)
+    {
+      self->pool =
+        ad_thread_pool_new (self->num_groups);
+      if (!self->pool)
+        {
+          stream_resampler_free (self);
+          return NULL;
+        }
+    }
+
+  return self;
+}
+
+typedef struct resample_task_data
+{
+  stream_resampler * resampler;
+
+  /** Interleaved frames of all channels to
+   * resample. */
+  const float *        in;
+  size_t               num_in_frames;
+  unsigned int         channels;
+
+  /** Interleaved destination of all channels. */
+  float *              out;
+  size_t               max_out_frames;
+} resample_task_data;
+
+/**
+ * Resamples the pending input of one channel group
+ * and writes the result into its channels of the
+ * destination.
+ */
+static void
+resample_group_task (
+  void * data,
+  size_t task)
+{
+  resample_task_data * td =
+    (resample_task_data *) data;
+  stream_resampler * self = td->resampler;
+  resample_group * group = &self->groups[task];
+
+  /* a single group resamples all channels straight
+   * into the destination */
+  if (self->num_groups == 1)
+    {
+      group->frames_generated =
+        ad_resampler_process (
+          group->resampler, td->in,
+          td->num_in_frames, &group->frames_used,
+          td->out, td->max_out_frames,
+          self->end_of_input);
+      return;
+    }
+
+  ad_select_channels_range (
+    td->in, td->channels, group->in,
+    group->first_channel, group->channels,
+    td->num_in_frames);
+
+  group->frames_generated =
+    ad_resampler_process (
+      group->resampler, group->in,
+      td->num_in_frames, &group->frames_used,
+      group->out, td->max_out_frames,
+      self->end_of_input);
+  if (group->frames_generated <= 0)
+    return;
+
+  ad_interleave_channels (
+    group->out, group->channels, td->out,
+    group->first_channel, td->channels,
+    (size_t) group->frames_generated);
+}
+
+/**
+ * Decodes more frames if needed and resamples them
+ * on all channel groups into \p dst.
+ *
+ * No more frames than requested are generated so
+ * that nothing needs buffering between calls and
+ * varispeed changes apply from the next call.
+ *
+ * @return Number of frames written to \p dst, or
+ *   -1 on error.
+ */
+static ssize_t
+stream_resampler_process (
+  adecoder *         decoder,
+  stream_resampler * self,
+  float *            dst,
+  size_t             max_frames)
+{
+  if (self->in_pos == self->in_len &&
+      !self->end_of_input)
+    {
+      ssize_t frames_read =
+        read_mixed_frames (
+          decoder, decoder->src_in,
+          self->block_size);
+      if (frames_read < 0)
+        return -1;
+      if (frames_read == 0)
+        self->end_of_input = 1;
+      self->in_pos = 0;
+      self->in_len = (size_t) frames_read;
+    }
+
+  resample_task_data td = {
+    .resampler = self,
+    .in =
+      &decoder->src_in[
+        self->in_pos * decoder->out_channels],
+    .num_in_frames = self->in_len - self->in_pos,
+    .channels = decoder->out_channels,
+    .out = dst,
+    .max_out_frames = MIN (max_frames, self->block_size),
+  };
+  if (self->variable_ratio)
+    {
+      double ratio =
+        (double) self->out_rate /
+        (decoder->sample_rate * decoder->speed);
+      for (unsigned int i = 0; i < self->num_groups; i++)
+        ad_resampler_set_ratio (
+          self->groups[i].resampler, ratio);
+    }
+  if (self->pool)
+    ad_thread_pool_run (
+      self->pool, resample_group_task, &td,
+      self->num_groups);
+  else
+    resample_group_task (&td, 0);
+
+  /* the resamplers are fed the same frames so they
+   * stay in lockstep */
+  resample_group * first = &self->groups[0];
+  for (unsigned int i = 0; i < self->num_groups; i++)
+    {
+      resample_group * group = &self->groups[i];
+      if (group->frames_generated < 0)
+        return -1;
+      if (group->frames_used != first->frames_used ||
+          group->frames_generated !=
+            first->frames_generated)
+        {
+          dbg (
+            AUDEC_LOG_LEVEL_ERROR,
+            "Channel group resamplers out of sync");
+          return -1;
+        }
+    }
+
+  self->in_pos += first->frames_used;
+  if (self->end_of_input &&
+      first->frames_generated == 0)
+    self->done = 1;
+
+  return first->frames_generated;
+}
+
+/**
+ * Reads up to \p max_frames frames at the target
+ * sample rate through the streaming resampler.
+ */
+static ssize_t
+read_resampled_frames (
+  adecoder * decoder,
+  float *    dst,
+  size_t     max_frames)
+{
+  /* the target rate may have changed since the
+   * resampler was created */
+  if (decoder->resampler &&
+      (decoder->resampler->out_rate !=
+         get_stream_out_rate (decoder) ||
+       decoder->resampler->variable_ratio !=
+         decoder->varispeed))
+    free_resampler (decoder);
+
+  if (!decoder->resampler)
+    {
+      if (!decoder->src_in)
+        decoder->src_in =
+          malloc (
+            decoder->block_size * decoder->out_channels *
+            sizeof (float));
+      if (!decoder->src_in)
+        return -1;
+      decoder->resampler =
+        stream_resampler_new (decoder);
+      if (!decoder->resampler)
+        return -1;
+    }
+
+  stream_resampler * resampler = decoder->resampler;
+  size_t channels = decoder->out_channels;
+  size_t total_read = 0;
+  while (total_read < max_frames && !resampler->done)
+    {
+      ssize_t frames =
+        stream_resampler_process (
+          decoder, resampler,
+          &dst[total_read * channels],
+          max_frames - total_read);
+      if (frames < 0)
+        return -1;
+      total_read += (size_t) frames;
+    }
+
+  return (ssize_t) total_read;
+}
+
+ssize_t
+audec_read_frames (
+  AudecHandle * handle,
+  float *       dst,
+  size_t        max_frames)
+{
+  adecoder * decoder = (adecoder *) handle;
+  if (!decoder || !dst)
+    return -1;
+
+  if (decoder->channels == 0)
+    {
+      dbg (
+        AUDEC_LOG_LEVEL_ERROR,
+        "Invalid channel count");
+      return -1;
+    }
+
+  if (decoder->target_sample_rate ||
+      decoder->varispeed)
+    return
+      read_resampled_frames (
+        decoder, dst, max_frames);
+  else
+    return
+      read_mixed_frames (
+        decoder, dst, max_frames);
+}
+
+/**
+ * Stream settings that whole-file reads override
+ * and restore when done.
+ */
+typedef struct stream_settings
+{
+  unsigned int target_sample_rate;
+  int          varispeed;
+  double       speed;
+} stream_settings;
+
+/**
+ * Restores the settings saved by
+ * rewind_at_sample_rate().
+ */
+static void
+restore_stream_settings (
+  adecoder *              decoder,
+  const stream_settings * prev)
+{
+  decoder->target_sample_rate =
+    prev->target_sample_rate;
+  decoder->varispeed = prev->varispeed;
+  decoder->speed = prev->speed;
+}
+
+/**
+ * Sets the target sample rate, turns off the
+ * varispeed and seeks to the start of the file,
+ * for reading the whole file.
+ *
+ * The previous settings are saved in \p prev and
+ * callers restore them when done. On failure they
+ * are restored here.
+ */
+static int
+rewind_at_sample_rate (
+  adecoder *        decoder,
+  int               sample_rate,
+  stream_settings * prev)
+{
+  prev->target_sample_rate =
+    decoder->target_sample_rate;
+  prev->varispeed = decoder->varispeed;
+  prev->speed = decoder->speed;
+
+  /* whole files are read at their nominal speed */
+  decoder->varispeed = 0;
+  decoder->speed = 1.0;
+  if (audec_set_target_sample_rate (
+        (AudecHandle *) decoder, sample_rate) ||
+      audec_seek ((AudecHandle *) decoder, 0) < 0)
+    {
+      restore_stream_settings (decoder, prev);
+      return -1;
+    }
+
+  return 0;
+}
+
+static int64_t
+get_gcd (
+  int64_t a,
+  int64_t b)
+{
+  while (b)
+    {
+      int64_t tmp = a % b;
+      a = b;
+      b = tmp;
+    }
+  return a;
+}
+
+/**
+ * Returns the index of the first frame at
+ * \p out_rate that lies at or after frame \p pos at
+ * \p in_rate.
+ */
+static int64_t
+get_out_frame (
+  int64_t      pos,
+  unsigned int in_rate,
+  unsigned int out_rate)
+{
+  return
+    (pos * (int64_t) out_rate + (int64_t) in_rate - 1) /
+    (int64_t) in_rate;
+}
+
+ssize_t
+audec_get_num_frames (
+  AudecHandle * handle,
+  int           sample_rate)
+{
+  adecoder * decoder = (adecoder *) handle;
+  if (!decoder || decoder->channels == 0)
+    return -1;
+
+  AudecInfo nfo;
+  if (audec_info (handle, &nfo))
+    return -1;
+
+  if (sample_rate <= 0)
+    sample_rate = (int) nfo.sample_rate;
+  ssize_t buf_size =
+    get_buf_size_for_sample_rate (
+      &nfo, (unsigned int) sample_rate);
+  if (buf_size < 0)
+    return -1;
+
+  /* the ratio is valid at this point; count with
+   * integers so that the length is exact */
+  if (decoder->exact_length)
+    return
+      (ssize_t)
+      get_out_frame (
+        nfo.frames, nfo.sample_rate,
+        (unsigned int) sample_rate);
+
+  return buf_size / (ssize_t) nfo.channels;
+}
+
+int
+audec_set_exact_length (
+  AudecHandle * handle,
+  int           exact)
+{
+  adecoder * decoder = (adecoder *) handle;
+  if (!decoder)
+    return -1;
+
+  decoder->exact_length = exact != 0;
+
+  return 0;
+}
+
+/**
+ * Returns the number of frames a whole-file read
+ * at \p sample_rate returns in exact length mode,
+ * or -1 if not in exact length mode.
+ */
+static ssize_t
+get_exact_num_frames (
+  adecoder * decoder,
+  int        sample_rate)
+{
+  if (!decoder->exact_length)
+    return -1;
+
+  return
+    audec_get_num_frames (
+      (AudecHandle *) decoder, sample_rate);
+}
+
+/** Minimum number of input blocks per segment when
+ * resampling a whole file in parallel, so that the
+ * overlap stays small compared to the work. */
+#define MIN_SEGMENT_BLOCKS 16
+
+/**
+ * A span of the input resampled on its own and
+ * stitched into the output.
+ */
+typedef struct resample_segment
+{
+  /** Input frames fed to the resampler, including
+   * the overlap on each side. */
+  int64_t  stream_start;
+  int64_t  stream_end;
+
+  /** Output frames this segment writes. */
+  int64_t  out_start;
+  int64_t  out_end;
+
+  /** Output frames generated past out_start (only
+   * used for the last segment, whose length is
+   * decided by the resampler). */
+  int64_t  frames_written;
+
+  /** Whether resampling failed. */
+  int      failed;
+} resample_segment;
+
+typedef struct segmented_resample_data
+{
+  const float *      in;
+  int64_t            num_in_frames;
+  float *            out;
+  size_t             max_frames;
+  unsigned int       channels;
+  unsigned int       in_rate;
+  unsigned int       out_rate;
+  AudecResampleQuality quality;
+
+  /** Frames resampled at a time. */
+  size_t             block_size;
+
+  resample_segment * segments;
+} segmented_resample_data;
+
+/**
+ * Resamples one segment with a fresh resampler and
+ * copies the frames it owns into the output.
+ */
+static void
+resample_segment_task (
+  void * data,
+  size_t task)
+{
+  segmented_resample_data * sd =
+    (segmented_resample_data *) data;
+  resample_segment * seg = &sd->segments[task];
+  size_t channels = sd->channels;
+
+  ad_resampler * resampler =
+    ad_resampler_new (
+      sd->quality, channels, sd->in_rate,
+      sd->out_rate, 0);
+  float * scratch =
+    malloc (
+      sd->block_size * channels * sizeof (float));
+  if (!resampler || !scratch)
+    {
+      seg->failed = 1;
+      goto done;
+    }
+
+  /* the stream starts on a frame where the input
+   * and output grids line up, so this is exact */
+  int64_t gcd = get_gcd (sd->in_rate, sd->out_rate);
+  int64_t out_pos =
+    (seg->stream_start / (sd->in_rate / gcd)) *
+    (sd->out_rate / gcd);
+  int64_t in_pos = seg->stream_start;
+
+  /* without the overlap past the end, the
+   * resampler holds back the last frames. The
+   * input is flushed as a last resort to still
+   * fill the segment */
+  int end_of_input = 0;
+  while (out_pos < seg->out_end)
+    {
+      if (in_pos == seg->stream_end)
+        end_of_input = 1;
+
+      size_t frames_used;
+      ssize_t frames_generated =
+        ad_resampler_process (
+          resampler,
+          &sd->in[in_pos * (int64_t) channels],
+          (size_t) (seg->stream_end - in_pos),
+          &frames_used, scratch, sd->block_size,
+          end_of_input);
+      if (frames_generated < 0)
+        {
+          seg->failed = 1;
+          goto done;
+        }
+      in_pos += (int64_t) frames_used;
+      if (end_of_input && frames_generated == 0)
+        break;
+
+      /* keep the frames this segment owns */
+      int64_t gen_start = out_pos;
+      int64_t gen_end = out_pos + frames_generated;
+      int64_t copy_start =
+        MAX (gen_start, seg->out_start);
+      int64_t copy_end =
+        MIN (
+          MIN (gen_end, seg->out_end),
+          (int64_t) sd->max_frames);
+      if (copy_end > copy_start)
+        {
+          memcpy (
+            &sd->out[copy_start * (int64_t) channels],
+            &scratch[
+              (copy_start - gen_start) *
+                (int64_t) channels],
+            (size_t) (copy_end - copy_start) *
+              channels * sizeof (float));
+          seg->frames_written =
+            copy_end - seg->out_start;
+        }
+      out_pos = gen_end;
+      if (out_pos >= (int64_t) sd->max_frames)
+        break;
+    }
+
+done:
+  ad_resampler_free (resampler);
+  free (scratch);
+}
+
+/**
+ * Decodes the file from the start with the
+ * backend's parallel reader, if it has one and the
+ * frames need no channel mixing.
+ *
+ * @param out Array to decode to, or NULL to get the
+ *   number of frames in the file.
+ *
+ * @return the number of frames, or -1 if the file
+ *   must be decoded sequentially.
+ */
+static ssize_t
+read_frames_parallel (
+  adecoder * decoder,
+  float *    out,
+  size_t     max_frames)
+{
+  if (decoder->decode_threads < 2 ||
+      !decoder->plugin->read_parallel ||
+      decoder->channel_map || decoder->mix_matrix)
+    return -1;
+
+  ssize_t ret =
+    decoder->plugin->read_parallel (
+      decoder->data, out, max_frames,
+      decoder->decode_threads);
+  if (ret < 0 || !out)
+    return ret;
+
+  if (decoder->gain != 1.f)
+    ad_apply_gain (
+      out, (size_t) ret * decoder->channels,
+      decoder->gain);
+
+  /* continue reading from the end, as after
+   * decoding sequentially */
+  if (audec_seek ((AudecHandle *) decoder, ret) < 0)
+    return -1;
+
+  return ret;
+}
+
+/**
+ * Decodes the whole file at its own sample rate.
+ *
+ * @param num_frames Number of frames decoded.
+ *
+ * @return Interleaved frames to be free()'d, or
+ *   NULL on error.
+ */
+static float *
+decode_all_frames (
+  adecoder * decoder,
+  size_t *   num_frames)
+{
+  size_t channels = decoder->out_channels;
+
+  ssize_t total_frames =
+    read_frames_parallel (decoder, NULL, 0);
+  if (total_frames > 0)
+    {
+      float * frames =
+        malloc (
+          (size_t) total_frames * channels *
+          sizeof (float));
+      ssize_t frames_read =
+        frames ?
+        read_frames_parallel (
+          decoder, frames, (size_t) total_frames) :
+        -1;
+      if (frames_read >= 0)
+        {
+          *num_frames = (size_t) frames_read;
+          return frames;
+        }
+      free (frames);
+      if (audec_seek ((AudecHandle *) decoder, 0) < 0)
+        return NULL;
+    }
+
+  size_t capacity = decoder->block_size * 64;
+  size_t len = 0;
+  float * frames =
+    malloc (capacity * channels * sizeof (float));
+  while (frames)
+    {
+      if (capacity - len < decoder->block_size)
+        {
+          capacity *= 2;
+          float * tmp =
+            realloc (
+              frames,
+              capacity * channels * sizeof (float));
+          if (!tmp)
+            break;
+          frames = tmp;
+        }
+
+      ssize_t frames_read =
+        read_mixed_frames (
+          decoder, &frames[len * channels],
+          decoder->block_size);
+      if (frames_read < 0)
+        break;
+      if (frames_read == 0)
+        {
+          *num_frames = len;
+          return frames;
+        }
+      len += (size_t) frames_read;
+    }
+
+  free (frames);
+  return NULL;
+}
+
+/**
+ * Resamples the whole file by splitting it into
+ * time segments resampled on separate threads.
+ *
+ * Each segment starts and ends on frames where the
+ * input and output grids line up and is fed
+ * RESAMPLE_PREROLL-sized overlap on both sides, so
+ * the sinc filter sees the same input around every
+ * output frame as in a single pass and the
+ * stitched result matches it to within float
+ * rounding.
+ *
+ * @return Number of frames written, 0 if the file
+ *   is too short to split, or -1 on error.
+ */
+static ssize_t
+read_into_segmented (
+  adecoder * decoder,
+  float *    out,
+  size_t     max_frames)
+{
+  size_t num_in_frames;
+  float * in =
+    decode_all_frames (decoder, &num_in_frames);
+  if (!in)
+    return -1;
+
+  unsigned int in_rate = decoder->sample_rate;
+  unsigned int out_rate =
+    decoder->target_sample_rate;
+  int64_t gcd = get_gcd (in_rate, out_rate);
+  int64_t in_period = in_rate / gcd;
+  int64_t out_period = out_rate / gcd;
+  int64_t overlap =
+    RESAMPLE_PREROLL *
+    MAX (1, (in_rate + out_rate - 1) / out_rate);
+
+  size_t num_segments =
+    MIN (
+      decoder->resample_threads,
+      num_in_frames /
+        (decoder->block_size * MIN_SEGMENT_BLOCKS));
+  if (num_segments < 2)
+    {
+      free (in);
+      return 0;
+    }
+
+  resample_segment * segments =
+    calloc (num_segments, sizeof (resample_segment));
+  if (!segments)
+    {
+      free (in);
+      return -1;
+    }
+  for (size_t i = 0; i < num_segments; i++)
+    {
+      resample_segment * seg = &segments[i];
+      int64_t start =
+        (int64_t) (num_in_frames * i / num_segments);
+      start -= start % in_period;
+      seg->out_start = (start / in_period) * out_period;
+      seg->stream_start = MAX (0, start - overlap);
+      seg->stream_start -=
+        seg->stream_start % in_period;
+      if (i > 0)
+        {
+          resample_segment * prev = &segments[i - 1];
+          prev->out_end = seg->out_start;
+          prev->stream_end =
+            MIN (
+              (int64_t) num_in_frames,
+              start + overlap);
+        }
+    }
+  segments[num_segments - 1].out_end = INT64_MAX;
+  segments[num_segments - 1].stream_end =
+    (int64_t) num_in_frames;
+
+  ssize_t ret = -1;
+  ad_thread_pool * pool =
+    ad_thread_pool_new (
+      (unsigned int) num_segments);
+  if (!pool)
+    goto free_segments;
+
+  segmented_resample_data sd = {
+    .in = in,
+    .num_in_frames = (int64_t) num_in_frames,
+    .out = out,
+    .max_frames = max_frames,
+    .channels = decoder->out_channels,
+    .in_rate = in_rate,
+    .out_rate = out_rate,
+    .quality = decoder->quality,
+    .block_size = decoder->block_size,
+    .segments = segments,
+  };
+  ad_thread_pool_run (
+    pool, resample_segment_task, &sd, num_segments);
+  ad_thread_pool_free (pool);
+
+  for (size_t i = 0; i < num_segments; i++)
+    {
+      if (segments[i].failed)
+        {
+          dbg (
+            AUDEC_LOG_LEVEL_ERROR,
+            "Failed to resample segment %zu", i);
+          goto free_segments;
+        }
+    }
+
+  resample_segment * last =
+    &segments[num_segments - 1];
+  ret =
+    (ssize_t)
+    MIN (
+      (int64_t) max_frames,
+      last->out_start + last->frames_written);
+
+free_segments:
+  free (segments);
+  free (in);
+
+  return ret;
+}
+
+ssize_t
+audec_read_into (
+  AudecHandle * handle,
+  float *       out,
+  size_t        max_frames,
+  int           sample_rate)
+{
+  adecoder * decoder = (adecoder *) handle;
+  if (!decoder || !out)
+    return -1;
+
+  ssize_t exact_frames =
+    get_exact_num_frames (decoder, sample_rate);
+  if (exact_frames >= 0)
+    max_frames = MIN (max_frames, (size_t) exact_frames);
+
+  /* stream the whole file through the handle's
+   * resampler at the requested rate */
+  stream_settings prev;
+  if (rewind_at_sample_rate (
+        decoder, sample_rate, &prev))
+    return -1;
+
+  ssize_t ret = 0;
+  if (decoder->target_sample_rate &&
+      decoder->resample_threads > 1)
+    {
+      ret =
+        read_into_segmented (
+          decoder, out, max_frames);
+
+      /* too short to split */
+      if (ret == 0 && audec_seek (handle, 0) < 0)
+        ret = -1;
+    }
+  else if (!decoder->target_sample_rate)
+    {
+      ret =
+        read_frames_parallel (
+          decoder, out, max_frames);
+      if (ret < 0)
+        ret = audec_seek (handle, 0) < 0 ? -1 : 0;
+    }
+  if (ret == 0)
+    ret =
+      audec_read_frames (handle, out, max_frames);
+  restore_stream_settings (decoder, &prev);
+  if (ret < 0)
+    return -1;
+
+  /* the converter's flush may stop a few frames
+   * short of the exact length, which lie past the
+   * end of the input */
+  if (exact_frames >= 0 && (size_t) ret < max_frames)
+    {
+      memset (
+        &out[(size_t) ret * decoder->out_channels], 0,
+        (max_frames - (size_t) ret) *
+          decoder->out_channels * sizeof (float));
+      ret = (ssize_t) max_frames;
+    }
+
+  dbg (
+    AUDEC_LOG_LEVEL_INFO,
+    "%zd frames read (out buffer size %zu)",
+    ret, max_frames);
+
+  return ret;
+}
+
+ssize_t
+audec_read_range (
+  AudecHandle * handle,
+  float *       out,
+  size_t        max_frames,
+  int64_t       start,
+  int64_t       end,
+  int           sample_rate)
+{
+  adecoder * decoder = (adecoder *) handle;
+  if (!decoder || !out || start < 0 || end < start)
+    return -1;
+
+  if (max_frames == 0 || end == start)
+    return 0;
+
+  /* ranges are read at the nominal speed, like
+   * whole files */
+  stream_settings prev = {
+    .target_sample_rate =
+      decoder->target_sample_rate,
+    .varispeed = decoder->varispeed,
+    .speed = decoder->speed,
+  };
+  decoder->varispeed = 0;
+  decoder->speed = 1.0;
+  if (audec_set_target_sample_rate (
+        handle, sample_rate))
+    {
+      restore_stream_settings (decoder, &prev);
+      return -1;
+    }
+
+  ssize_t ret = -1;
+  if (!decoder->target_sample_rate)
+    {
+      if (audec_seek (handle, start) < 0)
+        goto restore;
+
+      ret =
+        audec_read_frames (
+          handle, out,
+          MIN (max_frames, (size_t) (end - start)));
+      goto restore;
+    }
+
+  unsigned int in_rate = decoder->sample_rate;
+  unsigned int out_rate =
+    decoder->target_sample_rate;
+  int64_t gcd = get_gcd (in_rate, out_rate);
+  int64_t in_period = in_rate / gcd;
+  int64_t out_period = out_rate / gcd;
+
+  /* start early enough to fill the filter history
+   * and on a frame where the input and output grids
+   * line up, so that the output phase is the same as
+   * when rendering from the start of the file */
+  int64_t preroll =
+    RESAMPLE_PREROLL *
+    MAX (1, (in_rate + out_rate - 1) / out_rate);
+  int64_t stream_start =
+    MAX (0, start - preroll);
+  stream_start -= stream_start % in_period;
+
+  int64_t first_out_frame =
+    get_out_frame (start, in_rate, out_rate);
+  int64_t num_out_frames =
+    get_out_frame (end, in_rate, out_rate) -
+    first_out_frame;
+  size_t frames_to_skip =
+    (size_t)
+    (first_out_frame -
+       (stream_start / in_period) * out_period);
+
+  if (audec_seek (handle, stream_start) < 0)
+    goto restore;
+
+  /* discard the pre-roll, using the output buffer
+   * as scratch space */
+  while (frames_to_skip > 0)
+    {
+      ssize_t frames_read =
+        audec_read_frames (
+          handle, out,
+          MIN (frames_to_skip, max_frames));
+      if (frames_read < 0)
+        goto restore;
+      if (frames_read == 0)
+        {
+          ret = 0;
+          goto restore;
+        }
+      frames_to_skip -= (size_t) frames_read;
+    }
+
+  ret =
+    audec_read_frames (
+      handle, out,
+      MIN (max_frames, (size_t) num_out_frames));
+
+restore:
+  restore_stream_settings (decoder, &prev);
+
+  return ret;
+}
+
+const float *
+audec_get_mapped_frames (
+  AudecHandle * handle,
+  int64_t *     num_frames)
+{
+  adecoder * decoder = (adecoder *) handle;
+  if (!decoder || !num_frames ||
+      !decoder->plugin->get_mapped_frames)
+    return NULL;
+
+  /* the frames would differ from what reads
+   * return */
+  if (decoder->gain != 1.f || decoder->channel_map ||
+      decoder->mix_matrix)
+    return NULL;
+
+  return
+    decoder->plugin->get_mapped_frames (
+      decoder->data, num_frames);
+}
+
+ssize_t
+audec_read (
+  AudecHandle * handle,
+  float **      out,
+  int           sample_rate)
+{
+  adecoder *decoder = (adecoder*) handle;
+  if (!decoder)
+    return -1;
+
+  if (*out != NULL)
+    {
+      dbg (
+        AUDEC_LOG_LEVEL_ERROR,
+        "Please set 'out' to NULL before calling "
+        "audec_read()");
+      return -1;
+    }
+
+  ssize_t num_out_frames =
+    audec_get_num_frames (handle, sample_rate);
+  if (num_out_frames < 0)
+    return -1;
+
+  *out =
+    malloc (
+      (size_t) num_out_frames * decoder->out_channels *
+      sizeof (float));
+  ssize_t ret =
+    audec_read_into (
+      handle, *out, (size_t) num_out_frames,
+      sample_rate);
+  if (ret < 0)
+    {
+      free (*out);
+      *out = NULL;
+      return -1;
+    }
+
+  if (ret != num_out_frames)
+    {
+      dbg (
+        AUDEC_LOG_LEVEL_INFO,
+        "Total frames read (%zd) and out "
+        "frames expected (%zd) do not match",
+        ret, num_out_frames);
+    }
+
+  return ret;
+}
+
+/**
+ * One of the outputs of audec_read_multi_rate().
+ */
+typedef struct rate_output
+{
+  /** Resampler, or NULL to copy the decoded
+   * frames. */
+  ad_resampler * resampler;
+
+  float *        out;
+  size_t         len;
+  size_t         capacity;
+
+  int            failed;
+} rate_output;
+
+typedef struct multi_rate_data
+{
+  rate_output * outputs;
+
+  /** Decoded block to feed to every output. */
+  const float * in;
+  size_t        num_in_frames;
+  unsigned int  channels;
+  int           end_of_input;
+} multi_rate_data;
+
+/**
+ * Feeds the decoded block to one of the outputs.
+ */
+static void
+multi_rate_task (
+  void * data,
+  size_t task)
+{
+  multi_rate_data * md = (multi_rate_data *) data;
+  rate_output * output = &md->outputs[task];
+  size_t channels = md->channels;
+
+  if (!output->resampler)
+    {
+      size_t frames =
+        MIN (
+          md->num_in_frames,
+          output->capacity - output->len);
+      memcpy (
+        &output->out[output->len * channels], md->in,
+        frames * channels * sizeof (float));
+      output->len += frames;
+      return;
+    }
+
+  size_t in_pos = 0;
+  while (output->len < output->capacity)
+    {
+      size_t frames_used;
+      ssize_t frames_generated =
+        ad_resampler_process (
+          output->resampler,
+          &md->in[in_pos * channels],
+          md->num_in_frames - in_pos, &frames_used,
+          &output->out[output->len * channels],
+          output->capacity - output->len,
+          md->end_of_input);
+      if (frames_generated < 0)
+        {
+          output->failed = 1;
+          return;
+        }
+      in_pos += frames_used;
+      output->len += (size_t) frames_generated;
+      if (frames_generated == 0 && frames_used == 0)
+        break;
+    }
+}
+
+int
+audec_read_multi_rate (
+  AudecHandle * handle,
+  const int *   sample_rates,
+  size_t        num_rates,
+  float **      out,
+  ssize_t *     num_frames)
+{
+  adecoder * decoder = (adecoder *) handle;
+  if (!decoder || !sample_rates || !out ||
+      !num_frames || num_rates == 0)
+    return -1;
+
+  for (size_t i = 0; i < num_rates; i++)
+    {
+      if (out[i] != NULL)
+        {
+          dbg (
+            AUDEC_LOG_LEVEL_ERROR,
+            "Please set all outputs to NULL before "
+            "calling audec_read_multi_rate()");
+          return -1;
+        }
+    }
+
+  stream_settings prev;
+  if (rewind_at_sample_rate (decoder, -1, &prev))
+    return -1;
+
+  int ret = -1;
+  size_t channels = decoder->out_channels;
+  rate_output * outputs =
+    calloc (num_rates, sizeof (rate_output));
+  ad_thread_pool * pool = NULL;
+  if (!outputs)
+    goto free_outputs;
+  for (size_t i = 0; i < num_rates; i++)
+    {
+      rate_output * output = &outputs[i];
+      int sample_rate = sample_rates[i];
+
+      /* same lengths as audec_read () */
+      ssize_t capacity =
+        audec_get_num_frames (handle, sample_rate);
+      if (capacity < 0)
+        goto free_outputs;
+      output->capacity = (size_t) capacity;
+      output->out =
+        malloc (
+          MAX (output->capacity, 1) * channels *
+          sizeof (float));
+      if (!output->out)
+        goto free_outputs;
+
+      if (sample_rate <= 0 ||
+          sample_rate == (int) decoder->sample_rate)
+        continue;
+
+      output->resampler =
+        ad_resampler_new (
+          decoder->quality, decoder->out_channels,
+          decoder->sample_rate,
+          (unsigned int) sample_rate, 0);
+      if (!output->resampler)
+        goto free_outputs;
+    }
+
+  if (decoder->resample_threads > 1 && num_rates > 1)
+    {
+      pool =
+        ad_thread_pool_new (
+          MIN (
+            decoder->resample_threads,
+            (unsigned int) num_rates));
+      if (!pool)
+        goto free_outputs;
+    }
+
+  if (!decoder->src_in)
+    decoder->src_in =
+      malloc (
+        decoder->block_size * channels * sizeof (float));
+  if (!decoder->src_in)
+    goto free_outputs;
+
+  /* decode each block once and hand it to every
+   * output */
+  multi_rate_data md = {
+    .outputs = outputs,
+    .in = decoder->src_in,
+    .channels = decoder->out_channels,
+  };
+  while (!md.end_of_input)
+    {
+      ssize_t frames_read =
+        read_mixed_frames (
+          decoder, decoder->src_in,
+          decoder->block_size);
+      if (frames_read < 0)
+        goto free_outputs;
+      md.num_in_frames = (size_t) frames_read;
+      md.end_of_input = frames_read == 0;
+
+      if (pool)
+        ad_thread_pool_run (
+          pool, multi_rate_task, &md, num_rates);
+      else
+        for (size_t i = 0; i < num_rates; i++)
+          multi_rate_task (&md, i);
+
+      for (size_t i = 0; i < num_rates; i++)
+        {
+          if (outputs[i].failed)
+            goto free_outputs;
+        }
+    }
+
+  for (size_t i = 0; i < num_rates; i++)
+    {
+      rate_output * output = &outputs[i];
+      if (decoder->exact_length)
+        {
+          memset (
+            &output->out[output->len * channels], 0,
+            (output->capacity - output->len) *
+              channels * sizeof (float));
+          output->len = output->capacity;
+        }
+      out[i] = outputs[i].out;
+      outputs[i].out = NULL;
+      num_frames[i] = (ssize_t) outputs[i].len;
+    }
+  ret = 0;
+
+free_outputs:
+  for (size_t i = 0; outputs && i < num_rates; i++)
+    {
+      ad_resampler_free (outputs[i].resampler);
+      free (outputs[i].out);
+    }
+  free (outputs);
+  if (pool)
+    ad_thread_pool_free (pool);
+  restore_stream_settings (decoder, &prev);
+
+  return ret;
+}
+
+/**
+ * Allocates an interleaved float buffer of
+ * the handle's block size.
+ */
+static float *
+alloc_block (
+  adecoder * decoder)
+{
+  return
+    malloc (
+      decoder->block_size * decoder->out_channels *
+      sizeof (float));
+}
+
+/**
+ * Returns the size of one sample in the given
+ * format in bytes.
+ */
+static size_t
+get_sample_size (
+  AudecSampleFormat format)
+{
+  switch (format)
+    {
+    case AUDEC_SAMPLE_FORMAT_FLOAT:
+      return sizeof (float);
+    case AUDEC_SAMPLE_FORMAT_S16:
+      return sizeof (int16_t);
+    case AUDEC_SAMPLE_FORMAT_S32:
+      return sizeof (int32_t);
+    case AUDEC_SAMPLE_FORMAT_DOUBLE:
+      return sizeof (double);
+    }
+
+  return 0;
+}
+
+/**
+ * Reads up to \p max_frames frames from the
+ * backend's native reader for \p format.
+ *
+ * @return the number of frames read, -1 on error,
+ * or -2 if the backend has no native reader for the
+ * format.
+ */
+static ssize_t
+read_plugin_frames_native (
+  adecoder *        decoder,
+  void *            dst,
+  size_t            max_frames,
+  AudecSampleFormat format)
+{
+  const ad_plugin * plugin = decoder->plugin;
+  if ((format == AUDEC_SAMPLE_FORMAT_S16 &&
+       !plugin->read_short) ||
+      (format == AUDEC_SAMPLE_FORMAT_S32 &&
+       !plugin->read_int) ||
+      (format == AUDEC_SAMPLE_FORMAT_DOUBLE &&
+       !plugin->read_double) ||
+      format == AUDEC_SAMPLE_FORMAT_FLOAT)
+    return -2;
+
+  size_t channels = decoder->channels;
+  size_t sample_size = get_sample_size (format);
+  size_t total_read = 0;
+  while (total_read < max_frames)
+    {
+      void * cur =
+        (char *) dst +
+        total_read * channels * sample_size;
+      size_t len = (max_frames - total_read) * channels;
+      ssize_t ret = -1;
+      switch (format)
+        {
+        case AUDEC_SAMPLE_FORMAT_S16:
+          ret =
+            plugin->read_short (
+              decoder->data, (int16_t *) cur, len);
+          break;
+        case AUDEC_SAMPLE_FORMAT_S32:
+          ret =
+            plugin->read_int (
+              decoder->data, (int32_t *) cur, len);
+          break;
+        case AUDEC_SAMPLE_FORMAT_DOUBLE:
+          ret =
+            plugin->read_double (
+              decoder->data, (double *) cur, len);
+          break;
+        case AUDEC_SAMPLE_FORMAT_FLOAT:
+          break;
+        }
+      if (ret < 0)
+        {
+          dbg (
+            AUDEC_LOG_LEVEL_ERROR,
+            "Failed to read from backend");
+          return -1;
+        }
+      if (ret == 0)
+        break;
+
+      total_read += (size_t) ret / channels;
+    }
+
+  return (ssize_t) total_read;
+}
+
+/**
+ * Converts interleaved float samples to the given
+ * format.
+ */
+static void
+convert_samples (
+  const float *     src,
+  void *            dst,
+  size_t            num_samples,
+  AudecSampleFormat format)
+{
+  switch (format)
+    {
+    case AUDEC_SAMPLE_FORMAT_FLOAT:
+      memcpy (dst, src, num_samples * sizeof (float));
+      break;
+    case AUDEC_SAMPLE_FORMAT_S16:
+      src_float_to_short_array (
+        src, (short *) dst, (int) num_samples);
+      break;
+    case AUDEC_SAMPLE_FORMAT_S32:
+      src_float_to_int_array (
+        src, (int *) dst, (int) num_samples);
+      break;
+    case AUDEC_SAMPLE_FORMAT_DOUBLE:
+      {
+        double * d = (double *) dst;
+        for (size_t i = 0; i < num_samples; i++)
+          d[i] = (double) src[i];
+      }
+      break;
+    }
+}
+
+ssize_t
+audec_read_frames_format (
+  AudecHandle *     handle,
+  void *            dst,
+  size_t            max_frames,
+  AudecSampleFormat format)
+{
+  adecoder * decoder = (adecoder *) handle;
+  if (!decoder || !dst)
+    return -1;
+
+  size_t sample_size = get_sample_size (format);
+  if (sample_size == 0)
+    {
+      dbg (
+        AUDEC_LOG_LEVEL_ERROR,
+        "Invalid sample format %d", format);
+      return -1;
+    }
+
+  if (format == AUDEC_SAMPLE_FORMAT_FLOAT)
+    return
+      audec_read_frames (
+        handle, (float *) dst, max_frames);
+
+  /* the resampler and the channel mixer only work
+   * on floats, otherwise use the backend's native
+   * reader if any */
+  if (!decoder->target_sample_rate &&
+      !decoder->varispeed && decoder->gain == 1.f &&
+      !decoder->channel_map && !decoder->mix_matrix)
+    {
+      ssize_t ret =
+        read_plugin_frames_native (
+          decoder, dst, max_frames, format);
+      if (ret != -2)
+        return ret;
+    }
+
+  if (!decoder->scratch)
+    decoder->scratch = alloc_block (decoder);
+
+  size_t channels = decoder->out_channels;
+  size_t total_read = 0;
+  while (total_read < max_frames)
+    {
+      ssize_t frames_read =
+        audec_read_frames (
+          handle, decoder->scratch,
+          MIN (
+            max_frames - total_read,
+            decoder->block_size));
+      if (frames_read < 0)
+        return -1;
+      if (frames_read == 0)
+        break;
+
+      convert_samples (
+        decoder->scratch,
+        (char *) dst +
+          total_read * channels * sample_size,
+        (size_t) frames_read * channels, format);
+      total_read += (size_t) frames_read;
+    }
+
+  return (ssize_t) total_read;
+}
+
+ssize_t
+audec_read_frames_planar (
+  AudecHandle *   handle,
+  float * const * dst,
+  size_t          max_frames)
+{
+  adecoder * decoder = (adecoder *) handle;
+  if (!decoder || !dst)
+    return -1;
+
+  if (!decoder->scratch)
+    decoder->scratch = alloc_block (decoder);
+
+  /* deinterleave block by block while the frames
+   * are still in cache */
+  size_t total_read = 0;
+  while (total_read < max_frames)
+    {
+      ssize_t frames_read =
+        audec_read_frames (
+          handle, decoder->scratch,
+          MIN (
+            max_frames - total_read,
+            decoder->block_size));
+      if (frames_read < 0)
+        return -1;
+      if (frames_read == 0)
+        break;
+
+      ad_deinterleave (
+        decoder->scratch, dst, total_read,
+        decoder->out_channels, (size_t) frames_read);
+      total_read += (size_t) frames_read;
+    }
+
+  return (ssize_t) total_read;
+}
+
+ssize_t
+audec_read_into_planar (
+  AudecHandle *   handle,
+  float * const * out,
+  size_t          max_frames,
+  int             sample_rate)
+{
+  adecoder * decoder = (adecoder *) handle;
+  if (!decoder || !out)
+    return -1;
+
+  ssize_t exact_frames =
+    get_exact_num_frames (decoder, sample_rate);
+  if (exact_frames >= 0)
+    max_frames = MIN (max_frames, (size_t) exact_frames);
+
+  stream_settings prev;
+  if (rewind_at_sample_rate (
+        decoder, sample_rate, &prev))
+    return -1;
+
+  ssize_t ret =
+    audec_read_frames_planar (
+      handle, out, max_frames);
+  restore_stream_settings (decoder, &prev);
+
+  if (ret >= 0 && exact_frames >= 0 &&
+      (size_t) ret < max_frames)
+    {
+      for (unsigned int c = 0;
+           c < decoder->out_channels; c++)
+        memset (
+          &out[c][ret], 0,
+          (max_frames - (size_t) ret) *
+            sizeof (float));
+      ret = (ssize_t) max_frames;
+    }
+
+  return ret;
+}
+
+/**
+ * Reads frames through the scratch block and
+ * downmixes them to mono, as float if \p dst_dbl is
+ * NULL or as double otherwise.
+ */
+static ssize_t
+read_frames_mono (
+  adecoder * decoder,
+  float *    dst,
+  double *   dst_dbl,
+  size_t     max_frames)
+{
+  if (!decoder->scratch)
+    decoder->scratch = alloc_block (decoder);
+
+  size_t total_read = 0;
+  while (total_read < max_frames)
+    {
+      ssize_t frames_read =
+        audec_read_frames (
+          (AudecHandle *) decoder, decoder->scratch,
+          MIN (
+            max_frames - total_read,
+            decoder->block_size));
+      if (frames_read < 0)
+        return -1;
+      if (frames_read == 0)
+        break;
+
+      if (dst_dbl)
+        ad_downmix_mono_dbl (
+          decoder->scratch, &dst_dbl[total_read],
+          decoder->out_channels, (size_t) frames_read);
+      else
+        ad_downmix_mono (
+          decoder->scratch, &dst[total_read],
+          decoder->out_channels, (size_t) frames_read);
+      total_read += (size_t) frames_read;
+    }
+
+  return (ssize_t) total_read;
+}
+
+ssize_t
+audec_read_frames_mono (
+  AudecHandle * handle,
+  float *       dst,
+  size_t        max_frames)
+{
+  adecoder * decoder = (adecoder *) handle;
+  if (!decoder || !dst)
+    return -1;
+
+  return
+    read_frames_mono (
+      decoder, dst, NULL, max_frames);
+}
+
+ssize_t
+audec_read_frames_mono_dbl (
+  AudecHandle * handle,
+  double *      dst,
+  size_t        max_frames)
+{
+  adecoder * decoder = (adecoder *) handle;
+  if (!decoder || !dst)
+    return -1;
+
+  return
+    read_frames_mono (
+      decoder, NULL, dst, max_frames);
+}
+
+ssize_t
+audec_read_mono_dbl (
+  void *      sf,
+  AudecInfo * nfo,
+  double *    d,
+  size_t      len,
+  int         sample_rate)
+{
+  adecoder * decoder = (adecoder *) sf;
+  UNUSED (nfo);
+  if (!decoder || !d)
+    return -1;
+  if (len < 1)
+    return 0;
+
+  stream_settings prev;
+  if (rewind_at_sample_rate (
+        decoder, sample_rate, &prev))
+    return -1;
+
+  ssize_t ret =
+    read_frames_mono (decoder, NULL, d, len);
+  restore_stream_settings (decoder, &prev);
+
+  return ret;
+}
 
 int
 audec_finfo (
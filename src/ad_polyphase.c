@@ -0,0 +1,433 @@
+/*
+ * Copyright (C) 2021 Alexandros Theodotou <alex at zrythm dot org>
+ *
+ * This file is part of libaudec
+ *
+ * libaudec is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libaudec is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with libaudec.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ad_dsp.h"
+#include "ad_plugin.h"
+#include "ad_polyphase.h"
+
+/** Largest reduced numerator or denominator of the
+ * ratio handled, enough for 147/160 (44.1k <->
+ * 48k) and 147/320 (44.1k <-> 96k). */
+#define MAX_FACTOR 320
+
+/** Largest coefficient table, in floats (256 KiB),
+ * so that it stays cache resident. */
+#define MAX_TABLE_SIZE 65536
+
+/** Input frames buffered per call, on top of the
+ * filter length. */
+#define BUF_BLOCK 1024
+
+struct ad_polyphase
+{
+  unsigned int channels;
+
+  /** Interpolation and decimation factors: every
+   * output frame advances the input by
+   * down / up frames. */
+  unsigned int up;
+  unsigned int down;
+
+  /** Taps per phase, a multiple of 4. */
+  size_t       num_taps;
+
+  /** Coefficients of each of the \ref up phases,
+   * one after the other. */
+  float *      coeffs;
+
+  /** Per-channel input history. */
+  float **     buf;
+  size_t       buf_size;
+
+  /** Start of the filter window of the next output
+   * frame in buf, and number of valid frames in
+   * buf. */
+  size_t       pos;
+  size_t       len;
+
+  /** Phase of the next output frame. */
+  unsigned int phase;
+
+  /** Input frames received and output frames
+   * generated since the start of the stream. */
+  uint64_t     total_in;
+  uint64_t     total_out;
+};
+
+/**
+ * Filter parameters for each polyphase quality.
+ *
+ * The stopband attenuation follows from the Kaiser
+ * beta: about 100 dB for the best quality and
+ * 75 dB for the medium one.
+ */
+typedef struct filter_params
+{
+  /** Zero crossings on each side of the kernel. */
+  double zero_crossings;
+
+  /** Kaiser window beta. */
+  double beta;
+
+  /** Cutoff relative to the lower Nyquist
+   * frequency. */
+  double cutoff;
+} filter_params;
+
+static int
+get_filter_params (
+  AudecResampleQuality quality,
+  filter_params *      params)
+{
+  switch (quality)
+    {
+    case AUDEC_RESAMPLE_QUALITY_POLYPHASE_BEST:
+      *params = (filter_params) { 96, 10.0, 0.96 };
+      return 0;
+    case AUDEC_RESAMPLE_QUALITY_POLYPHASE_MEDIUM:
+      *params = (filter_params) { 32, 7.5, 0.92 };
+      return 0;
+    case AUDEC_RESAMPLE_QUALITY_POLYPHASE_FASTEST:
+      *params = (filter_params) { 16, 9.0, 0.80 };
+      return 0;
+    default:
+      break;
+    }
+
+  return -1;
+}
+
+/**
+ * Zeroth order modified Bessel function of the
+ * first kind.
+ */
+static double
+bessel_i0 (
+  double x)
+{
+  double sum = 1.0;
+  double term = 1.0;
+  for (int k = 1; k < 64; k++)
+    {
+      double t = x / (2.0 * k);
+      term *= t * t;
+      sum += term;
+      if (term < sum * 1e-17)
+        break;
+    }
+  return sum;
+}
+
+static unsigned int
+get_gcd (
+  unsigned int a,
+  unsigned int b)
+{
+  while (b)
+    {
+      unsigned int tmp = a % b;
+      a = b;
+      b = tmp;
+    }
+  return a;
+}
+
+/**
+ * Fills in the coefficients of a Kaiser-windowed
+ * sinc low-pass filter, split into phases.
+ */
+static void
+compute_coeffs (
+  ad_polyphase *        self,
+  const filter_params * params,
+  double                fc,
+  size_t                half_taps)
+{
+  double i0_beta = bessel_i0 (params->beta);
+  double half_width = (double) half_taps;
+  for (unsigned int p = 0; p < self->up; p++)
+    {
+      float * h = &self->coeffs[p * self->num_taps];
+      double frac = (double) p / self->up;
+      double sum = 0.0;
+      for (size_t i = 0; i < self->num_taps; i++)
+        {
+          /* distance of the tap from the output
+           * frame, in input frames */
+          double d =
+            (double) i - (double) (half_taps - 1) - frac;
+          double u = d / half_width;
+          double val = 0.0;
+          if (fabs (u) < 1.0)
+            {
+              double x = M_PI * fc * d;
+              double sinc =
+                fabs (x) < 1e-12 ? 1.0 : sin (x) / x;
+              double w =
+                bessel_i0 (
+                  params->beta * sqrt (1.0 - u * u)) /
+                i0_beta;
+              val = fc * sinc * w;
+            }
+          h[i] = (float) val;
+          sum += val;
+        }
+
+      /* unity gain at DC for every phase */
+      for (size_t i = 0; i < self->num_taps; i++)
+        h[i] = (float) (h[i] / sum);
+    }
+}
+
+/**
+ * Works out the filter for the given rates.
+ *
+ * @return 0 if the ratio and quality are
+ *   supported, -1 otherwise.
+ */
+static int
+get_layout (
+  unsigned int         in_rate,
+  unsigned int         out_rate,
+  AudecResampleQuality quality,
+  filter_params *      params,
+  unsigned int *       up,
+  unsigned int *       down,
+  double *             fc,
+  size_t *             half_taps)
+{
+  if (in_rate == 0 || out_rate == 0 ||
+      get_filter_params (quality, params))
+    return -1;
+
+  unsigned int gcd = get_gcd (in_rate, out_rate);
+  *up = out_rate / gcd;
+  *down = in_rate / gcd;
+  if (*up > MAX_FACTOR || *down > MAX_FACTOR)
+    return -1;
+
+  /* when decimating, the cutoff moves down to the
+   * output Nyquist frequency and the kernel
+   * widens */
+  *fc =
+    params->cutoff *
+    (*up < *down ? (double) *up / *down : 1.0);
+  *half_taps =
+    (size_t) ceil (params->zero_crossings / *fc);
+  *half_taps = (*half_taps + 1) & ~(size_t) 1;
+  if ((size_t) *up * *half_taps * 2 > MAX_TABLE_SIZE)
+    return -1;
+
+  return 0;
+}
+
+int
+ad_polyphase_supports (
+  unsigned int         in_rate,
+  unsigned int         out_rate,
+  AudecResampleQuality quality)
+{
+  filter_params params;
+  unsigned int up, down;
+  double fc;
+  size_t half_taps;
+  return
+    get_layout (
+      in_rate, out_rate, quality, &params, &up,
+      &down, &fc, &half_taps) == 0;
+}
+
+ad_polyphase *
+ad_polyphase_new (
+  unsigned int         channels,
+  unsigned int         in_rate,
+  unsigned int         out_rate,
+  AudecResampleQuality quality)
+{
+  filter_params params;
+  unsigned int up, down;
+  double fc;
+  size_t half_taps;
+  if (channels == 0 ||
+      get_layout (
+        in_rate, out_rate, quality, &params, &up,
+        &down, &fc, &half_taps))
+    return NULL;
+  size_t num_taps = half_taps * 2;
+
+  ad_polyphase * self =
+    calloc (1, sizeof (ad_polyphase));
+  self->channels = channels;
+  self->up = up;
+  self->down = down;
+  self->num_taps = num_taps;
+  self->coeffs =
+    malloc (up * num_taps * sizeof (float));
+  self->buf_size = num_taps + BUF_BLOCK;
+  self->buf = calloc (channels, sizeof (float *));
+  for (unsigned int c = 0; c < channels; c++)
+    self->buf[c] =
+      malloc (self->buf_size * sizeof (float));
+
+  compute_coeffs (self, &params, fc, half_taps);
+  ad_polyphase_reset (self);
+
+  return self;
+}
+
+void
+ad_polyphase_reset (
+  ad_polyphase * self)
+{
+  /* the history before the first frame is
+   * silence */
+  size_t half_taps = self->num_taps / 2;
+  for (unsigned int c = 0; c < self->channels; c++)
+    memset (
+      self->buf[c], 0,
+      (half_taps - 1) * sizeof (float));
+  self->pos = 0;
+  self->len = half_taps - 1;
+  self->phase = 0;
+  self->total_in = 0;
+  self->total_out = 0;
+}
+
+/**
+ * Moves the unread history to the start of the
+ * buffers.
+ */
+static void
+compact (
+  ad_polyphase * self)
+{
+  if (self->pos == 0)
+    return;
+
+  for (unsigned int c = 0; c < self->channels; c++)
+    memmove (
+      self->buf[c], &self->buf[c][self->pos],
+      (self->len - self->pos) * sizeof (float));
+  self->len -= self->pos;
+  self->pos = 0;
+}
+
+/**
+ * Returns whether the output covers all of the
+ * input received, i.e. whether the next output
+ * frame would lie past the last input frame.
+ */
+static int
+is_flushed (
+  ad_polyphase * self)
+{
+  return
+    self->total_out * self->down >=
+      self->total_in * self->up;
+}
+
+size_t
+ad_polyphase_process (
+  ad_polyphase * self,
+  const float *  in,
+  size_t         in_frames,
+  size_t *       in_frames_used,
+  float *        out,
+  size_t         out_frames,
+  int            end_of_input)
+{
+  unsigned int channels = self->channels;
+  size_t num_taps = self->num_taps;
+  size_t used = 0;
+  size_t gen = 0;
+  while (gen < out_frames)
+    {
+      if (self->pos + num_taps > self->len)
+        {
+          compact (self);
+          if (used < in_frames)
+            {
+              size_t frames =
+                MIN (
+                  in_frames - used,
+                  self->buf_size - self->len);
+              ad_deinterleave (
+                &in[used * channels], self->buf,
+                self->len, channels, frames);
+              self->len += frames;
+              self->total_in += frames;
+              used += frames;
+              continue;
+            }
+          if (!end_of_input)
+            break;
+
+          /* flush with silence until the output
+           * covers all of the input */
+          if (is_flushed (self))
+            break;
+          for (unsigned int c = 0; c < channels; c++)
+            memset (
+              &self->buf[c][self->len], 0,
+              (num_taps - self->len) *
+                sizeof (float));
+          self->len = num_taps;
+        }
+      else if (end_of_input && used == in_frames &&
+               is_flushed (self))
+        break;
+
+      const float * h =
+        &self->coeffs[self->phase * num_taps];
+      for (unsigned int c = 0; c < channels; c++)
+        out[gen * channels + c] =
+          ad_dot_product (
+            &self->buf[c][self->pos], h, num_taps);
+      gen++;
+      self->total_out++;
+
+      self->phase += self->down;
+      self->pos += self->phase / self->up;
+      self->phase %= self->up;
+    }
+
+  *in_frames_used = used;
+  return gen;
+}
+
+void
+ad_polyphase_free (
+  ad_polyphase * self)
+{
+  if (!self)
+    return;
+
+  for (unsigned int c = 0; c < self->channels; c++)
+    free (self->buf[c]);
+  free (self->buf);
+  free (self->coeffs);
+  free (self);
+}
@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2021 Alexandros Theodotou <alex at zrythm dot org>
+ *
+ * This file is part of libaudec
+ *
+ * libaudec is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libaudec is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with libaudec.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include <samplerate.h>
+
+#include "ad_plugin.h"
+#include "ad_polyphase.h"
+#include "ad_resampler.h"
+
+/** Default number of idle resamplers kept for
+ * reuse. */
+#define DEFAULT_POOL_SIZE 16
+
+struct ad_resampler
+{
+  /** Built-in resampler, if the ratio and quality
+   * allow it. */
+  ad_polyphase * polyphase;
+
+  /** libsamplerate converter otherwise. */
+  SRC_STATE *    src_state;
+
+  double         ratio;
+
+  /* pool key. The rates only matter for the
+   * polyphase engine, whose filter depends on
+   * them, and are 0 otherwise */
+  AudecResampleQuality quality;
+  unsigned int   channels;
+  unsigned int   in_rate;
+  unsigned int   out_rate;
+
+  /** Next idle resampler in the pool. */
+  ad_resampler * next;
+};
+
+/**
+ * Idle resamplers shared by all handles, so that
+ * converting many short files does not set up a
+ * converter for each of them.
+ */
+static pthread_mutex_t pool_lock =
+  PTHREAD_MUTEX_INITIALIZER;
+static ad_resampler * pool_head = NULL;
+static size_t pool_len = 0;
+static size_t pool_max = DEFAULT_POOL_SIZE;
+
+static void
+destroy (
+  ad_resampler * self)
+{
+  ad_polyphase_free (self->polyphase);
+  if (self->src_state)
+    src_delete (self->src_state);
+  free (self);
+}
+
+/**
+ * Takes a matching resampler out of the pool.
+ *
+ * @return the resampler, or NULL if none matches.
+ */
+static ad_resampler *
+take_from_pool (
+  AudecResampleQuality quality,
+  unsigned int         channels,
+  unsigned int         in_rate,
+  unsigned int         out_rate)
+{
+  pthread_mutex_lock (&pool_lock);
+  ad_resampler ** link = &pool_head;
+  ad_resampler * self = NULL;
+  for (; *link; link = &(*link)->next)
+    {
+      ad_resampler * cur = *link;
+      if (cur->quality == quality &&
+          cur->channels == channels &&
+          cur->in_rate == in_rate &&
+          cur->out_rate == out_rate)
+        {
+          *link = cur->next;
+          cur->next = NULL;
+          pool_len--;
+          self = cur;
+          break;
+        }
+    }
+  pthread_mutex_unlock (&pool_lock);
+
+  return self;
+}
+
+int
+ad_resampler_get_src_converter (
+  AudecResampleQuality quality)
+{
+  switch (quality)
+    {
+    case AUDEC_RESAMPLE_QUALITY_BEST:
+    case AUDEC_RESAMPLE_QUALITY_POLYPHASE_BEST:
+      return SRC_SINC_BEST_QUALITY;
+    case AUDEC_RESAMPLE_QUALITY_MEDIUM:
+    case AUDEC_RESAMPLE_QUALITY_POLYPHASE_MEDIUM:
+      return SRC_SINC_MEDIUM_QUALITY;
+    case AUDEC_RESAMPLE_QUALITY_FASTEST:
+    case AUDEC_RESAMPLE_QUALITY_POLYPHASE_FASTEST:
+      return SRC_SINC_FASTEST;
+    case AUDEC_RESAMPLE_QUALITY_ZERO_ORDER_HOLD:
+      return SRC_ZERO_ORDER_HOLD;
+    case AUDEC_RESAMPLE_QUALITY_LINEAR:
+      return SRC_LINEAR;
+    }
+
+  return -1;
+}
+
+ad_resampler *
+ad_resampler_new (
+  AudecResampleQuality quality,
+  unsigned int         channels,
+  unsigned int         in_rate,
+  unsigned int         out_rate,
+  int                  variable_ratio)
+{
+  /* the polyphase qualities use the dedicated
+   * engine for common ratios such as 147/160,
+   * which has a fixed ratio */
+  int use_polyphase =
+    !variable_ratio &&
+    ad_polyphase_supports (in_rate, out_rate, quality);
+  unsigned int key_in_rate =
+    use_polyphase ? in_rate : 0;
+  unsigned int key_out_rate =
+    use_polyphase ? out_rate : 0;
+
+  /* pooled resamplers were reset when released */
+  ad_resampler * self =
+    take_from_pool (
+      quality, channels, key_in_rate, key_out_rate);
+  if (self)
+    {
+      self->ratio = (double) out_rate / in_rate;
+      return self;
+    }
+
+  self = calloc (1, sizeof (ad_resampler));
+  self->ratio = (double) out_rate / in_rate;
+  self->quality = quality;
+  self->channels = channels;
+  self->in_rate = key_in_rate;
+  self->out_rate = key_out_rate;
+
+  if (use_polyphase)
+    {
+      self->polyphase =
+        ad_polyphase_new (
+          channels, in_rate, out_rate, quality);
+      if (!self->polyphase)
+        {
+          free (self);
+          return NULL;
+        }
+      return self;
+    }
+
+  int err;
+  self->src_state =
+    src_new (
+      ad_resampler_get_src_converter (quality),
+      (int) channels, &err);
+  if (!self->src_state)
+    {
+      dbg (
+        AUDEC_LOG_LEVEL_ERROR,
+        "Failed to create a src state: %s",
+        src_strerror (err));
+      free (self);
+      return NULL;
+    }
+
+  return self;
+}
+
+ssize_t
+ad_resampler_process (
+  ad_resampler * self,
+  const float *  in,
+  size_t         in_frames,
+  size_t *       in_frames_used,
+  float *        out,
+  size_t         out_frames,
+  int            end_of_input)
+{
+  if (self->polyphase)
+    return
+      (ssize_t)
+      ad_polyphase_process (
+        self->polyphase, in, in_frames,
+        in_frames_used, out, out_frames,
+        end_of_input);
+
+  SRC_DATA src_data = {
+    .data_in = in,
+    .data_out = out,
+    .input_frames = (long) in_frames,
+    .output_frames = (long) out_frames,
+    .end_of_input = end_of_input,
+    .src_ratio = self->ratio,
+  };
+  int err = src_process (self->src_state, &src_data);
+  if (err)
+    {
+      dbg (
+        AUDEC_LOG_LEVEL_ERROR,
+        "An error occurred during resampling: %s",
+        src_strerror (err));
+      return -1;
+    }
+
+  *in_frames_used =
+    (size_t) src_data.input_frames_used;
+  return (ssize_t) src_data.output_frames_gen;
+}
+
+void
+ad_resampler_set_ratio (
+  ad_resampler * self,
+  double         ratio)
+{
+  self->ratio = ratio;
+}
+
+void
+ad_resampler_reset (
+  ad_resampler * self)
+{
+  if (self->polyphase)
+    ad_polyphase_reset (self->polyphase);
+  else
+    src_reset (self->src_state);
+}
+
+void
+ad_resampler_free (
+  ad_resampler * self)
+{
+  if (!self)
+    return;
+
+  ad_resampler_reset (self);
+
+  pthread_mutex_lock (&pool_lock);
+  if (pool_len < pool_max)
+    {
+      self->next = pool_head;
+      pool_head = self;
+      pool_len++;
+      self = NULL;
+    }
+  pthread_mutex_unlock (&pool_lock);
+
+  if (self)
+    destroy (self);
+}
+
+void
+ad_resampler_set_pool_size (
+  size_t max_resamplers)
+{
+  ad_resampler * to_free = NULL;
+
+  pthread_mutex_lock (&pool_lock);
+  pool_max = max_resamplers;
+  while (pool_len > pool_max)
+    {
+      ad_resampler * cur = pool_head;
+      pool_head = cur->next;
+      pool_len--;
+      cur->next = to_free;
+      to_free = cur;
+    }
+  pthread_mutex_unlock (&pool_lock);
+
+  while (to_free)
+    {
+      ad_resampler * next = to_free->next;
+      destroy (to_free);
+      to_free = next;
+    }
+}
@@ -0,0 +1,360 @@
+/*
+ * Copyright (C) 2021 Alexandros Theodotou <alex at zrythm dot org>
+ *
+ * This file is part of libaudec
+ *
+ * libaudec is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libaudec is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with libaudec.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ad_seek_index.h"
+
+/** Number of entries between checkpoints, which
+ * bounds the scan when expanding an entry. */
+#define CHECKPOINT_INTERVAL 64
+
+/** The offsets in the block follow from the frame
+ * sizes. */
+#define IMPLICIT_OFFSETS (1 << 0)
+
+/** The samples in the block are sample_step
+ * apart. */
+#define IMPLICIT_SAMPLES (1 << 1)
+
+typedef struct checkpoint
+{
+  uint64_t sample;
+  uint64_t offset;
+
+  /** Position of the block's deltas in data. */
+  uint32_t data_pos;
+
+  uint32_t flags;
+} checkpoint;
+
+struct ad_seek_index
+{
+  size_t           num_entries;
+
+  /** Usual distance between the samples of two
+   * frames. */
+  uint64_t         sample_step;
+
+  checkpoint *     checkpoints;
+  size_t           num_checkpoints;
+
+  /** Varint deltas of the entries that are not
+   * implied. */
+  uint8_t *        data;
+  size_t           data_len;
+
+  const uint8_t *  file;
+  size_t           file_size;
+  ad_frame_size_fn frame_size;
+  void *           user_data;
+};
+
+/**
+ * Expands entries one after the other from a
+ * checkpoint.
+ */
+typedef struct cursor
+{
+  const ad_seek_index * index;
+  const checkpoint *    cp;
+  size_t                pos;
+  ad_index_entry        entry;
+} cursor;
+
+static int
+put_varint (
+  ad_seek_index * self,
+  size_t *        capacity,
+  uint64_t        val)
+{
+  do
+    {
+      if (self->data_len == *capacity)
+        {
+          *capacity = *capacity ? *capacity * 2 : 256;
+          uint8_t * data =
+            realloc (self->data, *capacity);
+          if (!data)
+            return -1;
+          self->data = data;
+        }
+      uint8_t byte = (uint8_t) (val & 0x7f);
+      val >>= 7;
+      if (val)
+        byte |= 0x80;
+      self->data[self->data_len++] = byte;
+    }
+  while (val);
+
+  return 0;
+}
+
+static uint64_t
+get_varint (
+  const uint8_t * data,
+  size_t *        pos)
+{
+  uint64_t val = 0;
+  for (unsigned int shift = 0; shift < 64; shift += 7)
+    {
+      uint8_t byte = data[(*pos)++];
+      val |= (uint64_t) (byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        break;
+    }
+  return val;
+}
+
+/**
+ * Returns the offset of the frame following the
+ * one at \p offset, or 0 if unknown.
+ */
+static uint64_t
+get_next_offset (
+  const ad_seek_index * self,
+  uint64_t              offset)
+{
+  if (!self->file || offset >= self->file_size)
+    return 0;
+
+  size_t size =
+    self->frame_size (
+      self->file + offset,
+      self->file_size - (size_t) offset,
+      self->user_data);
+  return size ? offset + size : 0;
+}
+
+static void
+cursor_init (
+  cursor *              self,
+  const ad_seek_index * index,
+  size_t                block)
+{
+  self->index = index;
+  self->cp = &index->checkpoints[block];
+  self->pos = self->cp->data_pos;
+  self->entry.sample = self->cp->sample;
+  self->entry.offset = self->cp->offset;
+}
+
+static void
+cursor_next (
+  cursor * self)
+{
+  const ad_seek_index * index = self->index;
+  if (self->cp->flags & IMPLICIT_OFFSETS)
+    self->entry.offset =
+      get_next_offset (index, self->entry.offset);
+  else
+    self->entry.offset +=
+      get_varint (index->data, &self->pos);
+  if (self->cp->flags & IMPLICIT_SAMPLES)
+    self->entry.sample += index->sample_step;
+  else
+    self->entry.sample +=
+      get_varint (index->data, &self->pos);
+}
+
+ad_seek_index *
+ad_seek_index_new (
+  const ad_index_entry * entries,
+  size_t                 num_entries,
+  const uint8_t *        data,
+  size_t                 size,
+  ad_frame_size_fn       frame_size,
+  void *                 user_data)
+{
+  if (!entries || !num_entries)
+    return NULL;
+
+  ad_seek_index * self =
+    calloc (1, sizeof (ad_seek_index));
+  if (!self)
+    return NULL;
+
+  self->num_entries = num_entries;
+  self->file = frame_size ? data : NULL;
+  self->file_size = size;
+  self->frame_size = frame_size;
+  self->user_data = user_data;
+  if (num_entries > 1)
+    self->sample_step =
+      entries[num_entries - 1].sample -
+      entries[num_entries - 2].sample;
+
+  self->num_checkpoints =
+    (num_entries + CHECKPOINT_INTERVAL - 1) /
+    CHECKPOINT_INTERVAL;
+  self->checkpoints =
+    calloc (self->num_checkpoints, sizeof (checkpoint));
+  if (!self->checkpoints)
+    goto error;
+
+  size_t capacity = 0;
+  for (size_t i = 0; i < self->num_checkpoints; i++)
+    {
+      size_t first = i * CHECKPOINT_INTERVAL;
+      size_t end = first + CHECKPOINT_INTERVAL;
+      if (end > num_entries)
+        end = num_entries;
+
+      checkpoint * cp = &self->checkpoints[i];
+      cp->sample = entries[first].sample;
+      cp->offset = entries[first].offset;
+      cp->data_pos = (uint32_t) self->data_len;
+      cp->flags = IMPLICIT_OFFSETS | IMPLICIT_SAMPLES;
+      for (size_t j = first + 1; j < end; j++)
+        {
+          if (entries[j].offset !=
+                get_next_offset (
+                  self, entries[j - 1].offset))
+            cp->flags &= ~(uint32_t) IMPLICIT_OFFSETS;
+          if (entries[j].sample - entries[j - 1].sample !=
+                self->sample_step)
+            cp->flags &= ~(uint32_t) IMPLICIT_SAMPLES;
+        }
+
+      for (size_t j = first + 1; j < end; j++)
+        {
+          if (!(cp->flags & IMPLICIT_OFFSETS) &&
+              put_varint (
+                self, &capacity,
+                entries[j].offset -
+                  entries[j - 1].offset))
+            goto error;
+          if (!(cp->flags & IMPLICIT_SAMPLES) &&
+              put_varint (
+                self, &capacity,
+                entries[j].sample -
+                  entries[j - 1].sample))
+            goto error;
+        }
+    }
+
+  /* release the unused capacity */
+  if (self->data_len)
+    {
+      uint8_t * tmp =
+        realloc (self->data, self->data_len);
+      if (tmp)
+        self->data = tmp;
+    }
+
+  return self;
+
+error:
+  ad_seek_index_free (self);
+  return NULL;
+}
+
+size_t
+ad_seek_index_get_num_entries (
+  const ad_seek_index * self)
+{
+  return self->num_entries;
+}
+
+size_t
+ad_seek_index_get_memory_size (
+  const ad_seek_index * self)
+{
+  return
+    sizeof (ad_seek_index) +
+    self->num_checkpoints * sizeof (checkpoint) +
+    self->data_len;
+}
+
+size_t
+ad_seek_index_find (
+  const ad_seek_index * self,
+  uint64_t              sample)
+{
+  /* last checkpoint not after the sample */
+  size_t lo = 0, hi = self->num_checkpoints;
+  while (hi - lo > 1)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      if (self->checkpoints[mid].sample <= sample)
+        lo = mid;
+      else
+        hi = mid;
+    }
+
+  size_t found = lo * CHECKPOINT_INTERVAL;
+  size_t end = found + CHECKPOINT_INTERVAL;
+  if (end > self->num_entries)
+    end = self->num_entries;
+
+  cursor c;
+  cursor_init (&c, self, lo);
+  for (size_t i = found + 1; i < end; i++)
+    {
+      cursor_next (&c);
+      if (c.entry.sample > sample)
+        break;
+      found = i;
+    }
+
+  return found;
+}
+
+int
+ad_seek_index_get_entries (
+  const ad_seek_index * self,
+  size_t                start,
+  size_t                num_entries,
+  ad_index_entry *      entries)
+{
+  if (start > self->num_entries ||
+      num_entries > self->num_entries - start)
+    return -1;
+
+  cursor c;
+  size_t end = start + num_entries;
+  for (size_t i = start - start % CHECKPOINT_INTERVAL;
+       i < end; i++)
+    {
+      if (i % CHECKPOINT_INTERVAL == 0)
+        cursor_init (&c, self, i / CHECKPOINT_INTERVAL);
+      else
+        cursor_next (&c);
+
+      if (i >= start)
+        entries[i - start] = c.entry;
+    }
+
+  return 0;
+}
+
+void
+ad_seek_index_free (
+  ad_seek_index * self)
+{
+  if (!self)
+    return;
+
+  free (self->checkpoints);
+  free (self->data);
+  free (self);
+}
@@ -31,6 +31,16 @@
 typedef struct {
   SF_INFO sfinfo;
   SNDFILE *sffile;
+
+  /** Callbacks of a file opened from memory or
+   * with callbacks, and the position in it. */
+  AudecIO io;
+  void *  io_data;
+  int64_t io_size;
+  int64_t io_pos;
+
+  /** Contents of a file opened from memory. */
+  const uint8_t * buf;
 } sndfile_audio_decoder;
 
 static int parse_bit_depth(int format) {
@@ -83,31 +93,283 @@ ad_info_sndfile (
   return 0;
 }
 
-static void * ad_open_sndfile (
-  const char * filename,
-  AudecInfo *  nfo)
+/**
+ * Finishes opening, after sf_open*() returned.
+ *
+ * @param level Level to log a failure at. Files
+ *   not opened by name are probed with each backend
+ *   in turn, so failing is expected.
+ */
+static void *
+init_decoder (
+  sndfile_audio_decoder * priv,
+  const char *            name,
+  AudecInfo *             nfo,
+  AudecLogLevel           level)
 {
-  sndfile_audio_decoder *priv =
-    (sndfile_audio_decoder*)
-    calloc (1, sizeof(sndfile_audio_decoder));
-  priv->sfinfo.format = 0;
-  priv->sffile = sf_open (filename, SFM_READ, &priv->sfinfo);
   if (!(priv->sffile))
     {
       dbg (
-        AUDEC_LOG_LEVEL_ERROR,
-        "unable to open file '%s'.", filename);
-      puts (sf_strerror (NULL));
-      int e = sf_error (NULL);
-      dbg (
-        AUDEC_LOG_LEVEL_ERROR, "error=%i", e);
+        level, "unable to open file '%s': %s (error=%i)",
+        name, sf_strerror (NULL), sf_error (NULL));
       free (priv);
       return NULL;
     }
+  /* scale float data to the full integer range when
+   * reading integers */
+  sf_command (
+    priv->sffile, SFC_SET_SCALE_FLOAT_INT_READ,
+    NULL, SF_TRUE);
   ad_info_sndfile (priv, nfo);
   return (void*) priv;
 }
 
+static sf_count_t
+vio_get_filelen (
+  void * user_data)
+{
+  sndfile_audio_decoder * priv =
+    (sndfile_audio_decoder *) user_data;
+  return priv->io_size;
+}
+
+static sf_count_t
+vio_seek (
+  sf_count_t offset,
+  int        whence,
+  void *     user_data)
+{
+  sndfile_audio_decoder * priv =
+    (sndfile_audio_decoder *) user_data;
+  int64_t pos = offset;
+  if (whence == SEEK_CUR)
+    pos += priv->io_pos;
+  else if (whence == SEEK_END)
+    pos += priv->io_size;
+  if (pos < 0 ||
+      priv->io.seek ((uint64_t) pos, priv->io_data))
+    return -1;
+  priv->io_pos = pos;
+  return pos;
+}
+
+static sf_count_t
+vio_read (
+  void *     ptr,
+  sf_count_t count,
+  void *     user_data)
+{
+  sndfile_audio_decoder * priv =
+    (sndfile_audio_decoder *) user_data;
+  if (count <= 0)
+    return 0;
+  size_t read =
+    priv->io.read (ptr, (size_t) count, priv->io_data);
+  priv->io_pos += (int64_t) read;
+  return (sf_count_t) read;
+}
+
+static sf_count_t
+vio_write (
+  const void * ptr,
+  sf_count_t   count,
+  void *       user_data)
+{
+  (void) ptr;
+  (void) count;
+  (void) user_data;
+  return 0;
+}
+
+static sf_count_t
+vio_tell (
+  void * user_data)
+{
+  sndfile_audio_decoder * priv =
+    (sndfile_audio_decoder *) user_data;
+  return priv->io_pos;
+}
+
+static size_t
+memory_read (
+  void * buf,
+  size_t size,
+  void * user_data)
+{
+  sndfile_audio_decoder * priv =
+    (sndfile_audio_decoder *) user_data;
+  size_t avail = (size_t) (priv->io_size - priv->io_pos);
+  if (size > avail)
+    size = avail;
+  memcpy (buf, priv->buf + priv->io_pos, size);
+  return size;
+}
+
+static int
+memory_seek (
+  uint64_t position,
+  void *   user_data)
+{
+  sndfile_audio_decoder * priv =
+    (sndfile_audio_decoder *) user_data;
+  return position > (uint64_t) priv->io_size ? -1 : 0;
+}
+
+/** SF_FORMAT_MPEG, the major format of MP3 files
+ * in libsndfile 1.1 and later. It is an enum
+ * constant, so it cannot be tested for with the
+ * preprocessor, and older versions lack it. */
+#define SF_FORMAT_MPEG_MAJOR 0x230000
+
+/**
+ * Closes MP3 files opened without a filename,
+ * unless libsndfile is the preferred MP3 decoder,
+ * so that a file decodes the same however it is
+ * opened.
+ *
+ * @return 1 if the file was closed.
+ */
+static int
+leave_mp3_to_minimp3 (
+  sndfile_audio_decoder * priv)
+{
+#ifndef LIBSNDFILE_HAVE_MP3
+  if (priv->sffile &&
+      (priv->sfinfo.format & SF_FORMAT_TYPEMASK) ==
+        SF_FORMAT_MPEG_MAJOR)
+    {
+      sf_close (priv->sffile);
+      return 1;
+    }
+#else
+  (void) priv;
+#endif
+  return 0;
+}
+
+/**
+ * Opens the file through the callbacks set up in
+ * \p priv.
+ */
+static void *
+open_virtual (
+  sndfile_audio_decoder * priv,
+  const char *            name,
+  AudecInfo *             nfo)
+{
+  SF_VIRTUAL_IO vio = {
+    .get_filelen = vio_get_filelen,
+    .seek = vio_seek,
+    .read = vio_read,
+    .write = vio_write,
+    .tell = vio_tell,
+  };
+  if (priv->io.seek (0, priv->io_data))
+    {
+      free (priv);
+      return NULL;
+    }
+  priv->sffile =
+    sf_open_virtual (&vio, SFM_READ, &priv->sfinfo, priv);
+  if (leave_mp3_to_minimp3 (priv))
+    {
+      free (priv);
+      return NULL;
+    }
+  return
+    init_decoder (
+      priv, name, nfo, AUDEC_LOG_LEVEL_DEBUG);
+}
+
+static void *
+ad_open_memory_sndfile (
+  const void * data,
+  size_t       size,
+  AudecInfo *  nfo,
+  unsigned int flags)
+{
+  (void) flags;
+  sndfile_audio_decoder *priv =
+    (sndfile_audio_decoder*)
+    calloc (1, sizeof(sndfile_audio_decoder));
+  if (!priv)
+    return NULL;
+  priv->buf = (const uint8_t *) data;
+  priv->io_size = (int64_t) size;
+  priv->io.read = memory_read;
+  priv->io.seek = memory_seek;
+  priv->io_data = priv;
+
+  return open_virtual (priv, "<memory>", nfo);
+}
+
+static void *
+ad_open_io_sndfile (
+  const AudecIO * io,
+  void *          user_data,
+  AudecInfo *     nfo,
+  unsigned int    flags)
+{
+  (void) flags;
+
+  /* libsndfile needs the file size */
+  if (!io->get_size)
+    return NULL;
+  int64_t size = io->get_size (user_data);
+  if (size < 0)
+    return NULL;
+
+  sndfile_audio_decoder *priv =
+    (sndfile_audio_decoder*)
+    calloc (1, sizeof(sndfile_audio_decoder));
+  if (!priv)
+    return NULL;
+  priv->io = *io;
+  priv->io_data = user_data;
+  priv->io_size = size;
+
+  return open_virtual (priv, "<io>", nfo);
+}
+
+static void *
+ad_open_fd_sndfile (
+  int          fd,
+  AudecInfo *  nfo,
+  unsigned int flags)
+{
+  (void) flags;
+  sndfile_audio_decoder *priv =
+    (sndfile_audio_decoder*)
+    calloc (1, sizeof(sndfile_audio_decoder));
+  if (!priv)
+    return NULL;
+  priv->sffile =
+    sf_open_fd (fd, SFM_READ, &priv->sfinfo, SF_FALSE);
+  if (leave_mp3_to_minimp3 (priv))
+    {
+      free (priv);
+      return NULL;
+    }
+
+  return
+    init_decoder (
+      priv, "<fd>", nfo, AUDEC_LOG_LEVEL_DEBUG);
+}
+
+static void * ad_open_sndfile (
+  const char * filename,
+  AudecInfo *  nfo)
+{
+  sndfile_audio_decoder *priv =
+    (sndfile_audio_decoder*)
+    calloc (1, sizeof(sndfile_audio_decoder));
+  priv->sfinfo.format = 0;
+  priv->sffile = sf_open (filename, SFM_READ, &priv->sfinfo);
+  return
+    init_decoder (
+      priv, filename, nfo, AUDEC_LOG_LEVEL_ERROR);
+}
+
 static int ad_close_sndfile(void *sf) {
   sndfile_audio_decoder *priv = (sndfile_audio_decoder*) sf;
   if (!priv) return -1;
@@ -135,6 +397,36 @@ ad_read_sndfile (
   return sf_read_float (priv->sffile, d, len);
 }
 
+static ssize_t
+ad_read_short_sndfile (
+  void *sf, int16_t* d, size_t len)
+{
+  sndfile_audio_decoder *priv = (sndfile_audio_decoder*) sf;
+  if (!priv)
+    return -1;
+  return sf_read_short (priv->sffile, d, len);
+}
+
+static ssize_t
+ad_read_int_sndfile (
+  void *sf, int32_t* d, size_t len)
+{
+  sndfile_audio_decoder *priv = (sndfile_audio_decoder*) sf;
+  if (!priv)
+    return -1;
+  return sf_read_int (priv->sffile, d, len);
+}
+
+static ssize_t
+ad_read_double_sndfile (
+  void *sf, double* d, size_t len)
+{
+  sndfile_audio_decoder *priv = (sndfile_audio_decoder*) sf;
+  if (!priv)
+    return -1;
+  return sf_read_double (priv->sffile, d, len);
+}
+
 static int ad_eval_sndfile(const char *f) {
   char *ext = strrchr(f, '.');
   if (strstr (f, "://")) return 0;
@@ -170,10 +462,16 @@ static int ad_eval_sndfile(const char *f) {
 static const ad_plugin ad_sndfile = {
   .eval = &ad_eval_sndfile,
   .open = &ad_open_sndfile,
+  .open_memory = &ad_open_memory_sndfile,
+  .open_io = &ad_open_io_sndfile,
+  .open_fd = &ad_open_fd_sndfile,
   .close = &ad_close_sndfile,
   .info = &ad_info_sndfile,
   .seek = &ad_seek_sndfile,
-  .read = &ad_read_sndfile
+  .read = &ad_read_sndfile,
+  .read_short = &ad_read_short_sndfile,
+  .read_int = &ad_read_int_sndfile,
+  .read_double = &ad_read_double_sndfile,
 };
 
 /* dlopen handler */
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2021 Alexandros Theodotou <alex at zrythm dot org>
+ *
+ * This file is part of libaudec
+ *
+ * libaudec is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libaudec is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with libaudec.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "ad_plugin.h"
+#include "ad_thread_pool.h"
+
+struct ad_thread_pool
+{
+  pthread_t *     threads;
+
+  /** Number of worker threads (not counting the
+   * thread calling ad_thread_pool_run()). */
+  unsigned int    num_workers;
+
+  pthread_mutex_t lock;
+
+  /** Signalled when a new batch starts or when the
+   * pool is freed. */
+  pthread_cond_t  start_cond;
+
+  /** Signalled when the last task of a batch is
+   * done. */
+  pthread_cond_t  done_cond;
+
+  /* current batch */
+  ad_task_fn      fn;
+  void *          data;
+  size_t          num_tasks;
+  size_t          next_task;
+  size_t          tasks_left;
+
+  /** Incremented for every batch so that workers
+   * can tell a new batch from a spurious wakeup. */
+  unsigned long   batch;
+
+  int             quit;
+};
+
+/**
+ * Runs tasks of the current batch until none are
+ * left. Must be called with the lock held.
+ */
+static void
+run_tasks_locked (
+  ad_thread_pool * self)
+{
+  while (self->next_task < self->num_tasks)
+    {
+      size_t task = self->next_task++;
+      pthread_mutex_unlock (&self->lock);
+      self->fn (self->data, task);
+      pthread_mutex_lock (&self->lock);
+      if (--self->tasks_left == 0)
+        pthread_cond_broadcast (&self->done_cond);
+    }
+}
+
+static void *
+worker_func (
+  void * arg)
+{
+  ad_thread_pool * self = (ad_thread_pool *) arg;
+  unsigned long batch = 0;
+
+  pthread_mutex_lock (&self->lock);
+  for (;;)
+    {
+      while (!self->quit && self->batch == batch)
+        pthread_cond_wait (&self->start_cond, &self->lock);
+      if (self->quit)
+        break;
+
+      batch = self->batch;
+      run_tasks_locked (self);
+    }
+  pthread_mutex_unlock (&self->lock);
+
+  return NULL;
+}
+
+ad_thread_pool *
+ad_thread_pool_new (
+  unsigned int num_threads)
+{
+  ad_thread_pool * self =
+    calloc (1, sizeof (ad_thread_pool));
+  if (!self)
+    return NULL;
+
+  pthread_mutex_init (&self->lock, NULL);
+  pthread_cond_init (&self->start_cond, NULL);
+  pthread_cond_init (&self->done_cond, NULL);
+
+  if (num_threads > 1)
+    {
+      self->threads =
+        calloc (num_threads - 1, sizeof (pthread_t));
+      for (unsigned int i = 0; i < num_threads - 1; i++)
+        {
+          if (pthread_create (
+                &self->threads[i], NULL, worker_func,
+                self))
+            {
+              dbg (
+                AUDEC_LOG_LEVEL_ERROR,
+                "Failed to create worker thread");
+              break;
+            }
+          self->num_workers++;
+        }
+    }
+
+  return self;
+}
+
+void
+ad_thread_pool_run (
+  ad_thread_pool * self,
+  ad_task_fn       fn,
+  void *           data,
+  size_t           num_tasks)
+{
+  if (num_tasks == 0)
+    return;
+
+  pthread_mutex_lock (&self->lock);
+  self->fn = fn;
+  self->data = data;
+  self->num_tasks = num_tasks;
+  self->next_task = 0;
+  self->tasks_left = num_tasks;
+  self->batch++;
+  pthread_cond_broadcast (&self->start_cond);
+
+  /* work on the batch too instead of idling */
+  run_tasks_locked (self);
+  while (self->tasks_left > 0)
+    pthread_cond_wait (&self->done_cond, &self->lock);
+  pthread_mutex_unlock (&self->lock);
+}
+
+void
+ad_thread_pool_free (
+  ad_thread_pool * self)
+{
+  if (!self)
+    return;
+
+  pthread_mutex_lock (&self->lock);
+  self->quit = 1;
+  pthread_cond_broadcast (&self->start_cond);
+  pthread_mutex_unlock (&self->lock);
+
+  for (unsigned int i = 0; i < self->num_workers; i++)
+    pthread_join (self->threads[i], NULL);
+
+  pthread_mutex_destroy (&self->lock);
+  pthread_cond_destroy (&self->start_cond);
+  pthread_cond_destroy (&self->done_cond);
+  free (self->threads);
+  free (self);
+}
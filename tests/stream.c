@@ -0,0 +1,1660 @@
+/*
+ * Copyright (C) 2021 Alexandros Theodotou <alex at zrythm dot org>
+ *
+ * This file is part of libaudec
+ *
+ * libaudec is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libaudec is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with libaudec.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "helper.h"
+
+#include <audec/audec.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define BLOCK_SIZE 1000
+
+/**
+ * Reads the whole file in blocks and compares the
+ * result with a whole-file audec_read().
+ */
+static void
+test_read_frames (
+  const char * filename)
+{
+  AudecInfo nfo;
+  AudecHandle * handle =
+    audec_open (filename, &nfo);
+  ad_assert (handle);
+
+  float * whole = NULL;
+  ssize_t whole_frames =
+    audec_read (handle, &whole, -1);
+  ad_assert (whole_frames == nfo.frames);
+
+  ad_assert (audec_seek (handle, 0) == 0);
+
+  float block[BLOCK_SIZE * 8];
+  ad_assert (nfo.channels <= 8);
+  size_t total_read = 0;
+  ssize_t frames_read;
+  while ((frames_read =
+            audec_read_frames (
+              handle, block, BLOCK_SIZE)) > 0)
+    {
+      ad_assert (frames_read <= BLOCK_SIZE);
+      ad_assert (
+        total_read + (size_t) frames_read <=
+          (size_t) whole_frames);
+      ad_assert (
+        !memcmp (
+          block, &whole[total_read * nfo.channels],
+          (size_t) frames_read * nfo.channels *
+            sizeof (float)));
+      total_read += (size_t) frames_read;
+    }
+  ad_assert (frames_read == 0);
+  ad_assert (total_read == (size_t) whole_frames);
+
+  audec_close (handle);
+  free (whole);
+}
+
+/**
+ * Reads the whole file at the given sample rate in
+ * small blocks and in a single block and checks that
+ * the streams match.
+ */
+static void
+test_read_frames_resampled (
+  const char *         filename,
+  int                  sample_rate,
+  AudecResampleQuality quality)
+{
+  AudecInfo nfo;
+  AudecHandle * handle =
+    audec_open (filename, &nfo);
+  ad_assert (handle);
+  ad_assert (
+    audec_set_resample_quality (
+      handle, quality) == 0);
+  ad_assert (
+    audec_set_target_sample_rate (
+      handle, sample_rate) == 0);
+
+  size_t expected_frames =
+    (size_t)
+    ((double) nfo.frames *
+     ((double) sample_rate / nfo.sample_rate));
+  size_t max_frames = expected_frames + 4096;
+  float * whole =
+    malloc (max_frames * nfo.channels * sizeof (float));
+  ssize_t whole_frames =
+    audec_read_frames (handle, whole, max_frames);
+  ad_printf ("resampled frames %zd", whole_frames);
+  ad_assert (
+    labs ((long) whole_frames -
+          (long) expected_frames) < 64);
+
+  /* stream again in blocks after seeking back */
+  ad_assert (audec_seek (handle, 0) == 0);
+  float block[BLOCK_SIZE * 8];
+  ad_assert (nfo.channels <= 8);
+  size_t total_read = 0;
+  ssize_t frames_read;
+  while ((frames_read =
+            audec_read_frames (
+              handle, block, BLOCK_SIZE)) > 0)
+    {
+      ad_assert (
+        total_read + (size_t) frames_read <=
+          (size_t) whole_frames);
+      for (size_t i = 0;
+           i < (size_t) frames_read * nfo.channels;
+           i++)
+        {
+          ad_assert (
+            fabsf (
+              block[i] -
+              whole[total_read * nfo.channels + i]) <
+                1e-5f);
+        }
+      total_read += (size_t) frames_read;
+    }
+  ad_assert (frames_read == 0);
+  ad_assert (total_read == (size_t) whole_frames);
+
+  audec_close (handle);
+  free (whole);
+}
+
+/**
+ * Reads the whole file twice into the same
+ * caller-provided buffer.
+ */
+static void
+test_read_into (
+  const char * filename,
+  int          sample_rate)
+{
+  AudecInfo nfo;
+  AudecHandle * handle =
+    audec_open (filename, &nfo);
+  ad_assert (handle);
+
+  ssize_t num_frames =
+    audec_get_num_frames (handle, sample_rate);
+  ad_assert (num_frames > 0);
+  float * buf =
+    malloc (
+      (size_t) num_frames * nfo.channels *
+      sizeof (float));
+  for (int i = 0; i < 2; i++)
+    {
+      ssize_t frames_read =
+        audec_read_into (
+          handle, buf, (size_t) num_frames,
+          sample_rate);
+      ad_assert (frames_read == num_frames);
+    }
+
+  /* split into time segments resampled on several
+   * threads */
+  float * segmented =
+    malloc (
+      (size_t) num_frames * nfo.channels *
+      sizeof (float));
+  ad_assert (
+    audec_set_resample_threads (handle, 4) == 0);
+  ssize_t frames_read =
+    audec_read_into (
+      handle, segmented, (size_t) num_frames,
+      sample_rate);
+  ad_assert (frames_read == num_frames);
+  for (size_t i = 0;
+       i < (size_t) num_frames * nfo.channels; i++)
+    {
+      ad_assert (fabsf (segmented[i] - buf[i]) < 1e-4f);
+    }
+
+  audec_close (handle);
+  free (buf);
+  free (segmented);
+}
+
+/**
+ * Reads a range in the middle of the file and
+ * compares it with a whole-file render.
+ */
+static void
+test_read_range (
+  const char * filename,
+  int          sample_rate)
+{
+  AudecInfo nfo;
+  AudecHandle * handle =
+    audec_open (filename, &nfo);
+  ad_assert (handle);
+
+  float * whole = NULL;
+  ssize_t whole_frames =
+    audec_read (handle, &whole, sample_rate);
+  ad_assert (whole_frames > 0);
+
+  int64_t start = 12345;
+  int64_t end = 32345;
+  int64_t first_frame =
+    (start * sample_rate + nfo.sample_rate - 1) /
+    nfo.sample_rate;
+  int64_t num_frames =
+    (end * sample_rate + nfo.sample_rate - 1) /
+    nfo.sample_rate - first_frame;
+  float * range =
+    malloc (
+      (size_t) num_frames * nfo.channels *
+      sizeof (float));
+  ssize_t frames_read =
+    audec_read_range (
+      handle, range, (size_t) num_frames,
+      start, end, sample_rate);
+  ad_assert (frames_read == num_frames);
+  for (size_t i = 0;
+       i < (size_t) num_frames * nfo.channels; i++)
+    {
+      /* decoding after an MP3 seek is not
+       * bit-exact */
+      ad_assert (
+        fabsf (
+          range[i] -
+          whole[(size_t) first_frame * nfo.channels +
+                i]) < 1e-3f);
+    }
+
+  audec_close (handle);
+  free (whole);
+  free (range);
+}
+
+/**
+ * Reads the whole file into per-channel buffers
+ * and compares it with an interleaved read.
+ */
+static void
+test_read_planar (
+  const char * filename,
+  int          sample_rate)
+{
+  AudecInfo nfo;
+  AudecHandle * handle =
+    audec_open (filename, &nfo);
+  ad_assert (handle);
+
+  float * whole = NULL;
+  ssize_t whole_frames =
+    audec_read (handle, &whole, sample_rate);
+  ad_assert (whole_frames > 0);
+
+  float * planar[8];
+  ad_assert (nfo.channels <= 8);
+  for (unsigned int c = 0; c < nfo.channels; c++)
+    {
+      planar[c] =
+        malloc ((size_t) whole_frames * sizeof (float));
+    }
+  ssize_t frames_read =
+    audec_read_into_planar (
+      handle, planar, (size_t) whole_frames,
+      sample_rate);
+  ad_assert (frames_read == whole_frames);
+  for (size_t i = 0; i < (size_t) whole_frames; i++)
+    {
+      for (unsigned int c = 0; c < nfo.channels; c++)
+        {
+          ad_assert (
+            fabsf (
+              planar[c][i] -
+              whole[i * nfo.channels + c]) < 1e-5f);
+        }
+    }
+
+  audec_close (handle);
+  free (whole);
+  for (unsigned int c = 0; c < nfo.channels; c++)
+    {
+      free (planar[c]);
+    }
+}
+
+/**
+ * Reads the whole file in each sample format and
+ * compares it with a float read.
+ */
+static void
+test_read_format (
+  const char * filename,
+  int          sample_rate)
+{
+  AudecInfo nfo;
+  AudecHandle * handle =
+    audec_open (filename, &nfo);
+  ad_assert (handle);
+
+  float * whole = NULL;
+  ssize_t whole_frames =
+    audec_read (handle, &whole, sample_rate);
+  ad_assert (whole_frames > 0);
+  size_t num_samples =
+    (size_t) whole_frames * nfo.channels;
+
+  audec_set_target_sample_rate (
+    handle, sample_rate);
+  void * buf = malloc (num_samples * sizeof (double));
+  AudecSampleFormat formats[] = {
+    AUDEC_SAMPLE_FORMAT_S16,
+    AUDEC_SAMPLE_FORMAT_S32,
+    AUDEC_SAMPLE_FORMAT_DOUBLE,
+  };
+  for (size_t i = 0; i < 3; i++)
+    {
+      ad_assert (audec_seek (handle, 0) == 0);
+      ssize_t frames_read =
+        audec_read_frames_format (
+          handle, buf, (size_t) whole_frames,
+          formats[i]);
+      ad_assert (frames_read == whole_frames);
+      for (size_t j = 0; j < num_samples; j++)
+        {
+          double val = 0.0;
+          double tolerance = 1e-6;
+          switch (formats[i])
+            {
+            case AUDEC_SAMPLE_FORMAT_S16:
+              val = ((int16_t *) buf)[j] / 32768.0;
+              tolerance = 2.0 / 32768.0;
+              break;
+            case AUDEC_SAMPLE_FORMAT_S32:
+              val = ((int32_t *) buf)[j] / 2147483648.0;
+              break;
+            case AUDEC_SAMPLE_FORMAT_DOUBLE:
+              val = ((double *) buf)[j];
+              break;
+            default:
+              ad_assert (0);
+            }
+          ad_assert (
+            fabs (val - (double) whole[j]) < tolerance);
+        }
+    }
+
+  audec_close (handle);
+  free (whole);
+  free (buf);
+}
+
+/**
+ * Downmixes the file to mono and compares it with
+ * the average of the channels of an interleaved
+ * read.
+ */
+static void
+test_read_mono (
+  const char * filename,
+  int          sample_rate)
+{
+  AudecInfo nfo;
+  AudecHandle * handle =
+    audec_open (filename, &nfo);
+  ad_assert (handle);
+
+  float * whole = NULL;
+  ssize_t whole_frames =
+    audec_read (handle, &whole, sample_rate);
+  ad_assert (whole_frames > 0);
+
+  double * mono =
+    malloc ((size_t) whole_frames * sizeof (double));
+  ssize_t frames_read =
+    audec_read_mono_dbl (
+      handle, &nfo, mono, (size_t) whole_frames,
+      sample_rate);
+  ad_assert (frames_read == whole_frames);
+  for (size_t i = 0; i < (size_t) whole_frames; i++)
+    {
+      double sum = 0.0;
+      for (unsigned int c = 0; c < nfo.channels; c++)
+        {
+          sum += (double) whole[i * nfo.channels + c];
+        }
+      ad_assert (
+        fabs (mono[i] - sum / nfo.channels) < 1e-5);
+    }
+
+  /* the output length is bounded by the buffer */
+  frames_read =
+    audec_read_mono_dbl (
+      handle, &nfo, mono, 100, sample_rate);
+  ad_assert (frames_read == 100);
+
+  /* float variant */
+  float * mono_flt =
+    malloc ((size_t) whole_frames * sizeof (float));
+  ad_assert (audec_seek (handle, 0) == 0);
+  audec_set_target_sample_rate (
+    handle, sample_rate);
+  frames_read =
+    audec_read_frames_mono (
+      handle, mono_flt, (size_t) whole_frames);
+  ad_assert (frames_read == whole_frames);
+  for (size_t i = 0; i < (size_t) whole_frames; i++)
+    {
+      ad_assert (
+        fabs ((double) mono_flt[i] - mono[i]) < 1e-5);
+    }
+
+  audec_close (handle);
+  free (whole);
+  free (mono);
+  free (mono_flt);
+}
+
+/**
+ * Reads the file with a channel selection and with
+ * a mix matrix and compares it with an interleaved
+ * read.
+ */
+static void
+test_resample_threads (
+  const char * filename,
+  int          sample_rate)
+{
+  AudecInfo nfo;
+  AudecHandle * handle =
+    audec_open (filename, &nfo);
+  ad_assert (handle);
+  ad_assert (
+    audec_set_target_sample_rate (
+      handle, sample_rate) == 0);
+
+  size_t max_frames =
+    (size_t)
+    ((double) nfo.frames *
+     ((double) sample_rate / nfo.sample_rate)) +
+    4096;
+  float * single =
+    malloc (max_frames * nfo.channels * sizeof (float));
+  ssize_t single_frames =
+    audec_read_frames (handle, single, max_frames);
+  ad_assert (single_frames > 0);
+
+  /* resample the channels on separate threads, in
+   * blocks */
+  ad_assert (
+    audec_set_resample_threads (handle, 2) == 0);
+  ad_assert (audec_seek (handle, 0) == 0);
+  float block[BLOCK_SIZE * 8];
+  ad_assert (nfo.channels <= 8);
+  size_t total_read = 0;
+  ssize_t frames_read;
+  while ((frames_read =
+            audec_read_frames (
+              handle, block, BLOCK_SIZE)) > 0)
+    {
+      ad_assert (
+        total_read + (size_t) frames_read <=
+          (size_t) single_frames);
+      for (size_t i = 0;
+           i < (size_t) frames_read * nfo.channels;
+           i++)
+        {
+          ad_assert (
+            fabsf (
+              block[i] -
+              single[total_read * nfo.channels + i]) <
+                1e-5f);
+        }
+      total_read += (size_t) frames_read;
+    }
+  ad_assert (frames_read == 0);
+  ad_assert (total_read == (size_t) single_frames);
+
+  audec_close (handle);
+  free (single);
+}
+
+static void
+test_read_multi_rate (
+  const char * filename,
+  int          sample_rate)
+{
+  AudecInfo nfo;
+  AudecHandle * handle =
+    audec_open (filename, &nfo);
+  ad_assert (handle);
+
+  int sample_rates[] = {
+    sample_rate, -1, 96000 };
+  float * outs[3] = { NULL, NULL, NULL };
+  ssize_t num_frames[3];
+  for (int threads = 1; threads <= 2; threads++)
+    {
+      ad_assert (
+        audec_set_resample_threads (
+          handle, (unsigned int) threads) == 0);
+      ad_assert (
+        audec_read_multi_rate (
+          handle, sample_rates, 3, outs,
+          num_frames) == 0);
+
+      /* each output matches a separate read */
+      for (int i = 0; i < 3; i++)
+        {
+          float * single = NULL;
+          ssize_t single_frames =
+            audec_read (
+              handle, &single, sample_rates[i]);
+          ad_assert (single_frames > 0);
+          ad_assert (num_frames[i] == single_frames);
+          for (size_t j = 0;
+               j < (size_t) single_frames * nfo.channels;
+               j++)
+            {
+              ad_assert (
+                fabsf (outs[i][j] - single[j]) < 1e-4f);
+            }
+          free (single);
+          free (outs[i]);
+          outs[i] = NULL;
+        }
+    }
+
+  audec_close (handle);
+}
+
+static void
+test_exact_length (
+  const char * filename,
+  int          sample_rate)
+{
+  AudecInfo nfo;
+  AudecHandle * handle =
+    audec_open (filename, &nfo);
+  ad_assert (handle);
+  ad_assert (audec_set_exact_length (handle, 1) == 0);
+
+  ssize_t expected_frames =
+    (ssize_t)
+    ((nfo.frames * (int64_t) sample_rate +
+        nfo.sample_rate - 1) / nfo.sample_rate);
+  ad_assert (
+    audec_get_num_frames (handle, sample_rate) ==
+      expected_frames);
+
+  float * out = NULL;
+  ad_assert (
+    audec_read (handle, &out, sample_rate) ==
+      expected_frames);
+  free (out);
+
+  audec_close (handle);
+}
+
+static void
+test_varispeed (
+  const char * filename)
+{
+  AudecInfo nfo;
+  AudecHandle * handle =
+    audec_open (filename, &nfo);
+  ad_assert (handle);
+  ad_assert (audec_set_varispeed (handle, 0.0) == -1);
+
+  /* play the first half at double speed and the
+   * rest at normal speed */
+  ad_assert (audec_set_varispeed (handle, 2.0) == 0);
+  float block[BLOCK_SIZE * 8];
+  ad_assert (nfo.channels <= 8);
+  size_t total_read = 0;
+  ssize_t frames_read;
+  int speed_changed = 0;
+  while ((frames_read =
+            audec_read_frames (
+              handle, block, BLOCK_SIZE)) > 0)
+    {
+      total_read += (size_t) frames_read;
+      if (!speed_changed &&
+          total_read >= (size_t) nfo.frames / 4)
+        {
+          ad_assert (
+            audec_set_varispeed (handle, 1.0) == 0);
+          speed_changed = 1;
+        }
+    }
+  ad_assert (frames_read == 0);
+  ad_assert (speed_changed);
+  ad_printf ("varispeed frames %zu", total_read);
+  ad_assert (
+    labs ((long) total_read -
+          (long) (nfo.frames * 3 / 4)) < 4096);
+
+  /* the target rate is checked together with the
+   * speed */
+  ad_assert (audec_set_varispeed (handle, 2.0) == 0);
+  ad_assert (
+    audec_set_target_sample_rate (
+      handle, (int) nfo.sample_rate / 200) == -1);
+
+  /* whole-file reads ignore the varispeed */
+  float * whole = NULL;
+  ssize_t whole_frames =
+    audec_read (handle, &whole, -1);
+  ad_assert (whole_frames == nfo.frames);
+  AudecHandle * plain_handle =
+    audec_open (filename, &nfo);
+  ad_assert (plain_handle);
+  float * plain = NULL;
+  ad_assert (
+    audec_read (plain_handle, &plain, -1) ==
+      whole_frames);
+  ad_assert (
+    memcmp (
+      whole, plain,
+      (size_t) whole_frames * nfo.channels *
+        sizeof (float)) == 0);
+  free (whole);
+  free (plain);
+  audec_close (plain_handle);
+
+  audec_close (handle);
+}
+
+static void
+test_resampler_pool (
+  const char * filename,
+  int          sample_rate)
+{
+  /* the second handle reuses the first one's
+   * resampler, which must start from a clean
+   * state */
+  float * outs[2] = { NULL, NULL };
+  ssize_t num_frames[2];
+  AudecInfo nfo;
+  for (int i = 0; i < 2; i++)
+    {
+      AudecHandle * handle =
+        audec_open (filename, &nfo);
+      ad_assert (handle);
+      num_frames[i] =
+        audec_read (handle, &outs[i], sample_rate);
+      ad_assert (num_frames[i] > 0);
+      audec_close (handle);
+    }
+  ad_assert (num_frames[0] == num_frames[1]);
+  ad_assert (
+    memcmp (
+      outs[0], outs[1],
+      (size_t) num_frames[0] * nfo.channels *
+        sizeof (float)) == 0);
+  free (outs[0]);
+  free (outs[1]);
+
+  audec_set_resampler_pool_size (0);
+}
+
+static void
+test_lazy_open (
+  const char * filename)
+{
+  AudecInfo nfo, lazy_nfo;
+  AudecHandle * handle = audec_open (filename, &nfo);
+  AudecHandle * lazy_handle =
+    audec_open_with_flags (
+      filename, &lazy_nfo, AUDEC_OPEN_LAZY_INDEX);
+  ad_assert (handle && lazy_handle);
+  ad_assert (lazy_nfo.frames > 0);
+  ad_assert (lazy_nfo.channels == nfo.channels);
+  ad_assert (lazy_nfo.sample_rate == nfo.sample_rate);
+
+  /* same samples from the start and after seeking,
+   * which builds the index */
+  const ssize_t block = 1024;
+  float * buf =
+    calloc ((size_t) (block * nfo.channels), sizeof (float));
+  float * lazy_buf =
+    calloc ((size_t) (block * nfo.channels), sizeof (float));
+  int64_t positions[] = { -1, nfo.frames / 2, 0 };
+  for (size_t i = 0; i < 3; i++)
+    {
+      if (positions[i] >= 0)
+        {
+          ad_assert (
+            audec_seek (handle, positions[i]) ==
+              positions[i]);
+          ad_assert (
+            audec_seek (lazy_handle, positions[i]) ==
+              positions[i]);
+        }
+      ssize_t num_frames =
+        audec_read_frames (handle, buf, block);
+      ad_assert (num_frames == block);
+      ad_assert (
+        audec_read_frames (
+          lazy_handle, lazy_buf, block) == num_frames);
+      ad_assert (
+        memcmp (
+          buf, lazy_buf,
+          (size_t) (num_frames * nfo.channels) *
+            sizeof (float)) == 0);
+    }
+
+  /* once indexed, the length is exact */
+  audec_info (lazy_handle, &lazy_nfo);
+  ad_assert (lazy_nfo.frames == nfo.frames);
+
+  free (buf);
+  free (lazy_buf);
+  audec_close (handle);
+  audec_close (lazy_handle);
+}
+
+typedef struct memory_file
+{
+  const uint8_t * data;
+  size_t          size;
+  size_t          pos;
+} memory_file;
+
+static size_t
+memory_file_read (
+  void * buf,
+  size_t size,
+  void * user_data)
+{
+  memory_file * f = (memory_file *) user_data;
+  if (size > f->size - f->pos)
+    size = f->size - f->pos;
+  memcpy (buf, f->data + f->pos, size);
+  f->pos += size;
+  return size;
+}
+
+static int
+memory_file_seek (
+  uint64_t position,
+  void *   user_data)
+{
+  memory_file * f = (memory_file *) user_data;
+  if (position > f->size)
+    return -1;
+  f->pos = (size_t) position;
+  return 0;
+}
+
+static int64_t
+memory_file_get_size (
+  void * user_data)
+{
+  memory_file * f = (memory_file *) user_data;
+  return (int64_t) f->size;
+}
+
+/**
+ * Reads the whole file and a block from the middle
+ * and checks they match the given samples.
+ */
+static void
+check_handle (
+  AudecHandle *   handle,
+  const float *   expected,
+  ssize_t         expected_frames,
+  unsigned int    channels)
+{
+  ad_assert (handle);
+  float * out = NULL;
+  ssize_t num_frames = audec_read (handle, &out, -1);
+  ad_assert (num_frames == expected_frames);
+  ad_assert (
+    memcmp (
+      out, expected,
+      (size_t) num_frames * channels *
+        sizeof (float)) == 0);
+
+  int64_t pos = expected_frames / 2;
+  ad_assert (audec_seek (handle, pos) == pos);
+  ad_assert (
+    audec_read_frames (handle, out, 1024) == 1024);
+  ad_assert (
+    memcmp (
+      out, &expected[(size_t) pos * channels],
+      1024 * channels * sizeof (float)) == 0);
+
+  free (out);
+  audec_close (handle);
+}
+
+/**
+ * Checks that a file opened from memory, callbacks
+ * or a descriptor went to the same backend as when
+ * opened by name, which reports the same info.
+ * MP3s in particular must be decoded by minimp3
+ * even when libsndfile can decode them.
+ */
+static void
+check_same_nfo (
+  const AudecInfo * nfo,
+  const AudecInfo * expected)
+{
+  ad_assert (nfo->frames == expected->frames);
+  ad_assert (nfo->channels == expected->channels);
+  ad_assert (nfo->sample_rate == expected->sample_rate);
+  ad_assert (nfo->length == expected->length);
+  ad_assert (nfo->bit_depth == expected->bit_depth);
+  ad_assert (nfo->bit_rate == expected->bit_rate);
+}
+
+static void
+test_open_memory_io (
+  const char * filename)
+{
+  AudecInfo nfo;
+  AudecHandle * handle = audec_open (filename, &nfo);
+  ad_assert (handle);
+  float * expected = NULL;
+  ssize_t expected_frames =
+    audec_read (handle, &expected, -1);
+  ad_assert (expected_frames > 2048);
+  audec_close (handle);
+
+  FILE * f = fopen (filename, "rb");
+  ad_assert (f);
+  fseek (f, 0, SEEK_END);
+  size_t size = (size_t) ftell (f);
+  fseek (f, 0, SEEK_SET);
+  uint8_t * data = malloc (size);
+  ad_assert (fread (data, 1, size, f) == size);
+  fclose (f);
+
+  AudecInfo mem_nfo;
+  handle = audec_open_memory (data, size, &mem_nfo, 0);
+  check_same_nfo (&mem_nfo, &nfo);
+  check_handle (
+    handle, expected, expected_frames, nfo.channels);
+
+  AudecIO io = {
+    .read = memory_file_read,
+    .seek = memory_file_seek,
+    .get_size = memory_file_get_size,
+  };
+  for (int lazy = 0; lazy < 2; lazy++)
+    {
+      memory_file mf = { .data = data, .size = size };
+      AudecInfo io_nfo;
+      handle =
+        audec_open_io (
+          &io, &mf, &io_nfo,
+          lazy ? AUDEC_OPEN_LAZY_INDEX : 0);
+      check_same_nfo (&io_nfo, &nfo);
+      check_handle (
+        handle, expected, expected_frames, nfo.channels);
+    }
+
+  int fd = open (filename, O_RDONLY);
+  ad_assert (fd >= 0);
+  AudecInfo fd_nfo;
+  handle = audec_open_fd (fd, &fd_nfo, 0);
+  check_same_nfo (&fd_nfo, &nfo);
+  check_handle (
+    handle, expected, expected_frames, nfo.channels);
+  close (fd);
+
+  /* a pipe cannot be rewound between backends, so
+   * only libsndfile reads it */
+  int pipe_fds[2];
+  ad_assert (pipe (pipe_fds) == 0);
+  pid_t pid = fork ();
+  ad_assert (pid >= 0);
+  if (pid == 0)
+    {
+      close (pipe_fds[0]);
+      size_t written = 0;
+      while (written < size)
+        {
+          ssize_t ret =
+            write (
+              pipe_fds[1], data + written,
+              size - written);
+          if (ret <= 0)
+            _exit (1);
+          written += (size_t) ret;
+        }
+      _exit (0);
+    }
+  close (pipe_fds[1]);
+  AudecInfo pipe_nfo;
+  handle = audec_open_fd (pipe_fds[0], &pipe_nfo, 0);
+  if (str_endswith (filename, ".mp3"))
+    {
+      ad_assert (!handle);
+    }
+  else
+    {
+      ad_assert (handle);
+      float * out =
+        malloc (
+          (size_t) expected_frames * nfo.channels *
+          sizeof (float));
+      ssize_t total = 0, ret;
+      while ((ret =
+                audec_read_frames (
+                  handle,
+                  &out[(size_t) total * nfo.channels],
+                  (size_t) (expected_frames - total)))
+             > 0)
+        total += ret;
+      ad_assert (total == expected_frames);
+      ad_assert (
+        memcmp (
+          out, expected,
+          (size_t) total * nfo.channels *
+            sizeof (float)) == 0);
+      free (out);
+      audec_close (handle);
+    }
+  close (pipe_fds[0]);
+  ad_assert (waitpid (pid, NULL, 0) == pid);
+
+  /* not an audio file */
+  memset (data, 0, size);
+  ad_assert (!audec_open_memory (data, size, &mem_nfo, 0));
+
+  free (data);
+  free (expected);
+}
+
+static void
+test_seek_accuracy (
+  const char * filename)
+{
+  AudecInfo nfo;
+  AudecHandle * handle = audec_open (filename, &nfo);
+  ad_assert (handle);
+  float * whole = NULL;
+  ssize_t whole_frames =
+    audec_read (handle, &whole, -1);
+  ad_assert (whole_frames > 4096);
+
+  /* seeking anywhere, including on either side of
+   * MP3 frame boundaries, gives the same samples as
+   * decoding from the start */
+  const size_t block = 512;
+  size_t channels = (size_t) nfo.channels;
+  float * buf = calloc (block * channels, sizeof (float));
+  for (int64_t i = 0; i < 24; i++)
+    {
+      int64_t pos =
+        i * (whole_frames - (int64_t) block) / 24;
+      if (i % 3 == 1)
+        pos = (pos / 1152) * 1152;
+      else if (i % 3 == 2)
+        pos = (pos / 1152) * 1152 - 1;
+      if (pos < 0)
+        pos = 0;
+
+      ad_assert (audec_seek (handle, pos) == pos);
+      ad_assert (
+        audec_read_frames (handle, buf, block) ==
+          (ssize_t) block);
+      ad_assert (
+        memcmp (
+          buf, &whole[(size_t) pos * channels],
+          block * channels * sizeof (float)) == 0);
+    }
+
+  free (buf);
+  free (whole);
+  audec_close (handle);
+}
+
+static void
+test_decode_threads (
+  const char * filename)
+{
+  AudecInfo nfo;
+  AudecHandle * handle = audec_open (filename, &nfo);
+  ad_assert (handle);
+  float * expected = NULL;
+  ssize_t expected_frames =
+    audec_read (handle, &expected, -1);
+  ad_assert (expected_frames > 0);
+
+  /* decoding ranges on separate threads gives the
+   * same samples */
+  ad_assert (audec_set_decode_threads (handle, 4) == 0);
+  float * out = NULL;
+  ssize_t num_frames = audec_read (handle, &out, -1);
+  ad_assert (num_frames == expected_frames);
+  ad_assert (
+    memcmp (
+      out, expected,
+      (size_t) (num_frames * nfo.channels) *
+        sizeof (float)) == 0);
+  free (out);
+  out = NULL;
+
+  /* gain is applied after decoding */
+  ad_assert (audec_set_gain (handle, 0.5f) == 0);
+  num_frames = audec_read (handle, &out, -1);
+  ad_assert (num_frames == expected_frames);
+  for (size_t i = 0;
+       i < (size_t) (num_frames * nfo.channels); i++)
+    {
+      ad_assert (
+        fabsf (out[i] - expected[i] * 0.5f) < 1e-6f);
+    }
+
+  free (out);
+  free (expected);
+  audec_close (handle);
+}
+
+/**
+ * Seeks to the middle of the file and reads a
+ * block.
+ */
+static void
+read_middle (
+  const char * filename,
+  AudecInfo *  nfo,
+  float *      buf,
+  ssize_t      block)
+{
+  AudecHandle * handle = audec_open (filename, nfo);
+  ad_assert (handle);
+  ad_assert (
+    audec_seek (handle, nfo->frames / 2) ==
+      nfo->frames / 2);
+  ad_assert (
+    audec_read_frames (handle, buf, (size_t) block) ==
+      block);
+  audec_close (handle);
+}
+
+static size_t
+count_dir_entries (
+  const char * dir)
+{
+  size_t count = 0;
+  DIR * d = opendir (dir);
+  ad_assert (d);
+  struct dirent * entry;
+  while ((entry = readdir (d)))
+    {
+      if (entry->d_name[0] != '.')
+        count++;
+    }
+  closedir (d);
+  return count;
+}
+
+static void
+test_index_cache (
+  const char * filename)
+{
+  const ssize_t block = 1024;
+  AudecInfo nfo;
+  AudecHandle * handle = audec_open (filename, &nfo);
+  ad_assert (handle);
+  audec_close (handle);
+  float * expected =
+    calloc ((size_t) (block * nfo.channels), sizeof (float));
+  float * buf =
+    calloc ((size_t) (block * nfo.channels), sizeof (float));
+  read_middle (filename, &nfo, expected, block);
+
+  char dir[] = "/tmp/audec_index_XXXXXX";
+  ad_assert (mkdtemp (dir));
+  ad_assert (audec_set_index_cache_dir (dir) == 0);
+
+  /* the first open saves the index and the second
+   * one loads it */
+  for (int i = 0; i < 2; i++)
+    {
+      AudecInfo cached_nfo;
+      read_middle (filename, &cached_nfo, buf, block);
+      ad_assert (cached_nfo.frames == nfo.frames);
+      ad_assert (
+        memcmp (
+          buf, expected,
+          (size_t) (block * nfo.channels) *
+            sizeof (float)) == 0);
+    }
+
+  int is_mp3 = str_endswith (filename, ".mp3");
+  ad_assert (count_dir_entries (dir) == (is_mp3 ? 1 : 0));
+
+  /* a corrupted index is ignored */
+  DIR * d = opendir (dir);
+  struct dirent * entry;
+  while ((entry = readdir (d)))
+    {
+      if (entry->d_name[0] == '.')
+        continue;
+      char path[512];
+      snprintf (
+        path, sizeof (path), "%s/%s", dir, entry->d_name);
+      FILE * f = fopen (path, "r+b");
+      ad_assert (f);
+      fseek (f, 40, SEEK_SET);
+      fputc (0x7f, f);
+      fclose (f);
+
+      read_middle (filename, &nfo, buf, block);
+      ad_assert (
+        memcmp (
+          buf, expected,
+          (size_t) (block * nfo.channels) *
+            sizeof (float)) == 0);
+      unlink (path);
+    }
+  closedir (d);
+
+  ad_assert (audec_set_index_cache_dir (NULL) == 0);
+  ad_assert (rmdir (dir) == 0);
+  free (expected);
+  free (buf);
+}
+
+static void
+test_block_size_and_gain (
+  const char * filename,
+  int          sample_rate)
+{
+  AudecInfo nfo;
+  AudecHandle * handle =
+    audec_open (filename, &nfo);
+  ad_assert (handle);
+  float * ref = NULL;
+  ssize_t ref_frames =
+    audec_read (handle, &ref, sample_rate);
+  ad_assert (ref_frames > 0);
+
+  ad_assert (audec_set_block_size (handle, 100) == -1);
+  ad_assert (audec_set_block_size (handle, 16384) == 0);
+  ad_assert (audec_set_gain (handle, 0.5f) == 0);
+  for (int i = 0; i < 2; i++)
+    {
+      /* resampled, then at the file's rate */
+      float * out = NULL;
+      ssize_t frames =
+        audec_read (
+          handle, &out, i == 0 ? sample_rate : -1);
+      ad_assert (frames > 0);
+      if (i == 0)
+        {
+          ad_assert (frames == ref_frames);
+          for (size_t j = 0;
+               j < (size_t) frames * nfo.channels; j++)
+            {
+              ad_assert (
+                fabsf (out[j] - ref[j] * 0.5f) < 1e-5f);
+            }
+        }
+      free (out);
+    }
+
+  audec_close (handle);
+  free (ref);
+}
+
+static void
+test_channel_mix (
+  const char * filename,
+  int          sample_rate)
+{
+  AudecInfo nfo;
+  AudecHandle * handle =
+    audec_open (filename, &nfo);
+  ad_assert (handle);
+  ad_assert (nfo.channels == 2);
+
+  float * whole = NULL;
+  ssize_t whole_frames =
+    audec_read (handle, &whole, -1);
+  ad_assert (whole_frames > 0);
+
+  /* pick the right channel only */
+  const unsigned int selection[] = { 1 };
+  ad_assert (
+    audec_set_channel_selection (
+      handle, selection, 1) == 0);
+  ad_assert (audec_get_output_channels (handle) == 1);
+  float * out = NULL;
+  ssize_t frames_read =
+    audec_read (handle, &out, -1);
+  ad_assert (frames_read == whole_frames);
+  for (size_t i = 0; i < (size_t) whole_frames; i++)
+    {
+      ad_assert (
+        fabsf (out[i] - whole[i * 2 + 1]) < 1e-6f);
+    }
+  free (out);
+  out = NULL;
+
+  /* swap the channels and add a sum channel */
+  const float matrix[] = {
+    0.f, 1.f,
+    1.f, 0.f,
+    0.5f, 0.5f,
+  };
+  ad_assert (
+    audec_set_mix_matrix (handle, matrix, 3) == 0);
+  ad_assert (audec_get_output_channels (handle) == 3);
+  frames_read =
+    audec_read (handle, &out, -1);
+  ad_assert (frames_read == whole_frames);
+  for (size_t i = 0; i < (size_t) whole_frames; i++)
+    {
+      float l = whole[i * 2];
+      float r = whole[i * 2 + 1];
+      ad_assert (fabsf (out[i * 3] - r) < 1e-6f);
+      ad_assert (fabsf (out[i * 3 + 1] - l) < 1e-6f);
+      ad_assert (
+        fabsf (out[i * 3 + 2] - (l + r) * 0.5f) <
+          1e-6f);
+    }
+  free (out);
+  out = NULL;
+
+  /* the mixed channels go through the resampler */
+  frames_read =
+    audec_read (handle, &out, sample_rate);
+  ad_assert (frames_read > 0);
+  free (out);
+
+  audec_close (handle);
+  free (whole);
+}
+
+typedef enum pcm_container
+{
+  PCM_CONTAINER_WAV,
+  PCM_CONTAINER_RF64,
+  PCM_CONTAINER_W64,
+  PCM_CONTAINER_AIFC,
+} pcm_container;
+
+static size_t
+put_uint (
+  uint8_t * buf,
+  uint64_t  val,
+  size_t    size,
+  int       big_endian)
+{
+  for (size_t i = 0; i < size; i++)
+    buf[big_endian ? size - 1 - i : i] =
+      (uint8_t) (val >> (i * 8));
+  return size;
+}
+
+/** Writes a header of \p len bytes for a W64
+ * chunk. */
+static size_t
+put_w64_chunk (
+  uint8_t *    buf,
+  const char * id,
+  uint64_t     len)
+{
+  static const uint8_t guid_tail[12] = {
+    0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1,
+    0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a,
+  };
+  memcpy (buf, id, 4);
+  memcpy (buf + 4, guid_tail, 12);
+  return 16 + put_uint (buf + 16, len + 24, 8, 0);
+}
+
+/**
+ * Writes a stereo 44.1 kHz file with the given
+ * 16-bit samples stored in \p bytes bytes.
+ *
+ * @return the size of the file.
+ */
+static size_t
+write_pcm_file (
+  uint8_t *       buf,
+  pcm_container   container,
+  size_t          bytes,
+  int             is_float,
+  int             big_endian,
+  const int16_t * samples,
+  size_t          num_samples)
+{
+  const size_t channels = 2;
+  size_t data_len = num_samples * bytes;
+  uint8_t * p = buf;
+  uint8_t fmt[16];
+  put_uint (fmt, is_float ? 3 : 1, 2, 0);
+  put_uint (fmt + 2, channels, 2, 0);
+  put_uint (fmt + 4, 44100, 4, 0);
+  put_uint (fmt + 8, 44100 * channels * bytes, 4, 0);
+  put_uint (fmt + 12, channels * bytes, 2, 0);
+  put_uint (fmt + 14, bytes * 8, 2, 0);
+
+  switch (container)
+    {
+    case PCM_CONTAINER_WAV:
+    case PCM_CONTAINER_RF64:
+      {
+        int rf64 = container == PCM_CONTAINER_RF64;
+        memcpy (p, rf64 ? "RF64" : "RIFF", 4);
+        put_uint (
+          p + 4, rf64 ? 0xffffffff : 36 + data_len, 4, 0);
+        memcpy (p + 8, "WAVE", 4);
+        p += 12;
+        if (rf64)
+          {
+            memcpy (p, "ds64", 4);
+            put_uint (p + 4, 28, 4, 0);
+            put_uint (p + 8, 64 + data_len, 8, 0);
+            put_uint (p + 16, data_len, 8, 0);
+            put_uint (p + 24, num_samples / channels, 8, 0);
+            put_uint (p + 32, 0, 4, 0);
+            p += 36;
+          }
+        memcpy (p, "fmt ", 4);
+        put_uint (p + 4, 16, 4, 0);
+        memcpy (p + 8, fmt, 16);
+        memcpy (p + 24, "data", 4);
+        put_uint (
+          p + 28, rf64 ? 0xffffffff : data_len, 4, 0);
+        p += 32;
+      }
+      break;
+    case PCM_CONTAINER_W64:
+      {
+        static const uint8_t riff_guid[16] = {
+          'r', 'i', 'f', 'f', 0x2e, 0x91, 0xcf, 0x11,
+          0xa5, 0xd6, 0x28, 0xdb, 0x04, 0xc1, 0x00, 0x00,
+        };
+        memcpy (p, riff_guid, 16);
+        put_uint (p + 16, 40 + 40 + 24 + data_len, 8, 0);
+        put_w64_chunk (p + 24, "wave", 0);
+        p += 40;
+        p += put_w64_chunk (p, "fmt ", 16);
+        memcpy (p, fmt, 16);
+        p += 16;
+        p += put_w64_chunk (p, "data", data_len);
+      }
+      break;
+    case PCM_CONTAINER_AIFC:
+      {
+        /* 44100 as an 80-bit extended float */
+        static const uint8_t rate[10] = {
+          0x40, 0x0e, 0xac, 0x44, 0, 0, 0, 0, 0, 0 };
+        memcpy (p, "FORM", 4);
+        put_uint (p + 4, 4 + 32 + 16 + data_len, 4, 1);
+        memcpy (p + 8, "AIFCCOMM", 8);
+        put_uint (p + 16, 24, 4, 1);
+        put_uint (p + 20, channels, 2, 1);
+        put_uint (p + 22, num_samples / channels, 4, 1);
+        put_uint (p + 26, bytes * 8, 2, 1);
+        memcpy (p + 28, rate, 10);
+        memcpy (
+          p + 38,
+          is_float ? "fl32" : (big_endian ? "NONE" : "sowt"),
+          4);
+        put_uint (p + 42, 0, 2, 1);
+        memcpy (p + 44, "SSND", 4);
+        put_uint (p + 48, 8 + data_len, 4, 1);
+        put_uint (p + 52, 0, 8, 1);
+        p += 60;
+      }
+      break;
+    }
+
+  for (size_t i = 0; i < num_samples; i++)
+    {
+      uint64_t val;
+      if (is_float && bytes == 4)
+        {
+          float f = samples[i] / 32768.f;
+          uint32_t bits;
+          memcpy (&bits, &f, sizeof (bits));
+          val = bits;
+        }
+      else if (is_float)
+        {
+          double d = samples[i] / 32768.0;
+          memcpy (&val, &d, sizeof (val));
+        }
+      else
+        val =
+          (uint64_t) (int64_t) samples[i] << ((bytes - 2) * 8);
+      p += put_uint (p, val, bytes, big_endian);
+    }
+
+  return (size_t) (p - buf);
+}
+
+/**
+ * Decodes uncompressed files in each container and
+ * encoding and checks that they all give back the
+ * samples they were written with.
+ */
+static void
+test_pcm_formats (void)
+{
+  static const int16_t samples[] = {
+    -32768, 32767, -1, 1, 0, 12345, -23456, 255,
+    4096, -4096, 32000, -32000, 7, -7, 100, -100,
+    1000, -1000,
+  };
+  const size_t num_samples =
+    sizeof (samples) / sizeof (samples[0]);
+  const size_t frames = num_samples / 2;
+  float expected[sizeof (samples) / sizeof (samples[0])];
+  for (size_t i = 0; i < num_samples; i++)
+    expected[i] = samples[i] / 32768.f;
+
+  const struct
+  {
+    pcm_container container;
+    size_t        bytes;
+    int           is_float;
+    int           big_endian;
+  } formats[] = {
+    { PCM_CONTAINER_WAV, 2, 0, 0 },
+    { PCM_CONTAINER_WAV, 3, 0, 0 },
+    { PCM_CONTAINER_WAV, 4, 0, 0 },
+    { PCM_CONTAINER_WAV, 4, 1, 0 },
+    { PCM_CONTAINER_WAV, 8, 1, 0 },
+    { PCM_CONTAINER_RF64, 2, 0, 0 },
+    { PCM_CONTAINER_W64, 3, 0, 0 },
+    { PCM_CONTAINER_AIFC, 2, 0, 1 },
+    { PCM_CONTAINER_AIFC, 3, 0, 1 },
+    { PCM_CONTAINER_AIFC, 2, 0, 0 },
+    { PCM_CONTAINER_AIFC, 4, 1, 1 },
+  };
+  uint8_t * file = malloc (512);
+  for (size_t i = 0;
+       i < sizeof (formats) / sizeof (formats[0]); i++)
+    {
+      size_t size =
+        write_pcm_file (
+          file, formats[i].container, formats[i].bytes,
+          formats[i].is_float, formats[i].big_endian,
+          samples, num_samples);
+
+      AudecInfo nfo;
+      AudecHandle * handle =
+        audec_open_memory (file, size, &nfo, 0);
+      ad_assert (handle);
+      ad_assert (nfo.channels == 2);
+      ad_assert (nfo.sample_rate == 44100);
+      ad_assert (nfo.frames == (int64_t) frames);
+
+      float out[sizeof (samples) / sizeof (samples[0])];
+      ad_assert (
+        audec_read_frames (handle, out, frames + 1) ==
+          (ssize_t) frames);
+      ad_assert (
+        memcmp (out, expected, sizeof (expected)) == 0);
+
+      /* float frames are returned in place */
+      int64_t mapped_frames = 0;
+      const float * mapped =
+        audec_get_mapped_frames (handle, &mapped_frames);
+      if (formats[i].container == PCM_CONTAINER_WAV &&
+          formats[i].is_float && formats[i].bytes == 4)
+        {
+          ad_assert (mapped);
+          ad_assert (mapped_frames == (int64_t) frames);
+          ad_assert (
+            memcmp (
+              mapped, expected, sizeof (expected)) == 0);
+          audec_set_gain (handle, 0.5f);
+          ad_assert (
+            !audec_get_mapped_frames (
+              handle, &mapped_frames));
+          audec_set_gain (handle, 1.f);
+        }
+      else
+        ad_assert (!mapped);
+
+      /* integers keep their value */
+      int16_t shorts[sizeof (samples) / sizeof (samples[0])];
+      ad_assert (audec_seek (handle, 1) == 1);
+      ad_assert (
+        audec_read_frames_format (
+          handle, shorts, frames,
+          AUDEC_SAMPLE_FORMAT_S16) ==
+          (ssize_t) frames - 1);
+      ad_assert (
+        memcmp (
+          shorts, &samples[2],
+          (num_samples - 2) * sizeof (int16_t)) == 0);
+      audec_close (handle);
+    }
+
+  /* files opened by name are mapped */
+  char filename[] = "/tmp/audec_pcm_XXXXXX";
+  int fd = mkstemp (filename);
+  ad_assert (fd >= 0);
+  size_t size =
+    write_pcm_file (
+      file, PCM_CONTAINER_WAV, 3, 0, 0, samples,
+      num_samples);
+  ad_assert (write (fd, file, size) == (ssize_t) size);
+  close (fd);
+
+  AudecInfo nfo;
+  AudecHandle * handle = audec_open (filename, &nfo);
+  ad_assert (handle);
+  ad_assert (nfo.frames == (int64_t) frames);
+  float out[sizeof (samples) / sizeof (samples[0])];
+  ad_assert (
+    audec_read_frames (handle, out, frames) ==
+      (ssize_t) frames);
+  ad_assert (memcmp (out, expected, sizeof (expected)) == 0);
+  audec_close (handle);
+  unlink (filename);
+  free (file);
+}
+
+/**
+ * Resamples a sine with the polyphase filter and
+ * checks it against the analytic signal.
+ *
+ * @param max_error Largest difference allowed,
+ *   away from the edges of the stream.
+ */
+static void
+test_resample_sine (
+  AudecResampleQuality quality,
+  int                  in_rate,
+  int                  out_rate,
+  double               max_error)
+{
+  const double freq = 1000.0;
+  const double amp = 0.5;
+  const size_t frames = (size_t) in_rate;
+  size_t size = 44 + frames * sizeof (float);
+  uint8_t * file = malloc (size);
+  memcpy (file, "RIFF", 4);
+  put_uint (file + 4, size - 8, 4, 0);
+  memcpy (file + 8, "WAVEfmt ", 8);
+  put_uint (file + 16, 16, 4, 0);
+  put_uint (file + 20, 3, 2, 0);
+  put_uint (file + 22, 1, 2, 0);
+  put_uint (file + 24, (uint64_t) in_rate, 4, 0);
+  put_uint (file + 28, (uint64_t) in_rate * 4, 4, 0);
+  put_uint (file + 32, 4, 2, 0);
+  put_uint (file + 34, 32, 2, 0);
+  memcpy (file + 36, "data", 4);
+  put_uint (file + 40, frames * sizeof (float), 4, 0);
+  for (size_t i = 0; i < frames; i++)
+    {
+      float val =
+        (float)
+        (amp * sin (2.0 * M_PI * freq * (double) i / in_rate));
+      memcpy (file + 44 + i * sizeof (float), &val, sizeof (val));
+    }
+
+  AudecInfo nfo;
+  AudecHandle * handle =
+    audec_open_memory (file, size, &nfo, 0);
+  ad_assert (handle);
+  ad_assert (
+    audec_set_resample_quality (handle, quality) == 0);
+  float * out = NULL;
+  ssize_t out_frames = audec_read (handle, &out, out_rate);
+  ad_assert (out_frames > 0);
+
+  /* skip the filter's ramp at both ends */
+  double error = 0;
+  for (ssize_t i = 256; i < out_frames - 256; i++)
+    {
+      double expected =
+        amp * sin (2.0 * M_PI * freq * (double) i / out_rate);
+      error = fmax (error, fabs ((double) out[i] - expected));
+    }
+  ad_printf (
+    "quality %d %d -> %d max error %g", quality,
+    in_rate, out_rate, error);
+  ad_assert (error < max_error);
+
+  free (out);
+  audec_close (handle);
+  free (file);
+}
+
+int main (
+  int argc, const char* argv[])
+{
+  ad_assert (argc > 2);
+
+  const char * filename = argv[1];
+  int sample_rate = atoi (argv[2]);
+
+  audec_init ();
+
+  test_read_frames (filename);
+  test_read_frames_resampled (
+    filename, sample_rate,
+    AUDEC_RESAMPLE_QUALITY_BEST);
+  test_read_into (filename, sample_rate);
+  test_read_range (filename, sample_rate);
+  test_read_range (filename, -1);
+  test_read_planar (filename, sample_rate);
+  test_read_format (filename, sample_rate);
+  test_read_format (filename, -1);
+  test_read_mono (filename, sample_rate);
+  test_channel_mix (filename, sample_rate);
+  test_resample_threads (filename, sample_rate);
+  test_read_multi_rate (filename, sample_rate);
+  test_exact_length (filename, sample_rate);
+  test_varispeed (filename);
+  test_block_size_and_gain (filename, sample_rate);
+  test_resampler_pool (filename, sample_rate);
+  test_lazy_open (filename);
+  test_index_cache (filename);
+  test_decode_threads (filename);
+  test_seek_accuracy (filename);
+  test_open_memory_io (filename);
+  test_pcm_formats ();
+  /* within -100 dBFS for the best quality and
+   * -80 dBFS for the others */
+  test_resample_sine (
+    AUDEC_RESAMPLE_QUALITY_POLYPHASE_BEST, 44100, 48000,
+    1e-5);
+  test_resample_sine (
+    AUDEC_RESAMPLE_QUALITY_POLYPHASE_BEST, 48000, 44100,
+    1e-5);
+  test_resample_sine (
+    AUDEC_RESAMPLE_QUALITY_POLYPHASE_MEDIUM, 44100, 48000,
+    1e-4);
+  test_resample_sine (
+    AUDEC_RESAMPLE_QUALITY_POLYPHASE_FASTEST, 44100, 48000,
+    1e-4);
+  test_read_frames_resampled (
+    filename, sample_rate,
+    AUDEC_RESAMPLE_QUALITY_LINEAR);
+  test_read_frames_resampled (
+    filename, sample_rate,
+    AUDEC_RESAMPLE_QUALITY_POLYPHASE_BEST);
+
+  return 0;
+}